@@ -0,0 +1,62 @@
+#pragma once
+#include "puzzle.hpp"
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Alternative solving engine on bitboards: for every digit, the grid is three 27-bit band
+ * masks (3 rows of 9 cells each) of the cells that can still hold the digit, or hold it already.
+ * Eliminations around an assigned cell, naked and hidden singles, and box-line interactions
+ * are then a few bitwise operations per band instead of loops over cells. The search guesses
+ * in a cell with the fewest candidates, and undoes a failed guess by restoring a copy of the state.
+ */
+class BandSolver
+{
+public:
+    const static int num_bands = 3;
+    const static int band_cells = 27;
+
+    struct State
+    {
+        // candidates[digit][band], bit (row % 3) * 9 + col. A solved cell keeps only its digit.
+        uint32_t candidates[9][num_bands];
+        uint32_t unsolved[num_bands];
+    };
+
+private:
+    State m_stack[82];
+    int m_depth = 0;
+    long long m_num_guesses = 0;
+    int m_num_logic_assignments = 0;
+
+    SearchLimits m_limits;
+    std::chrono::steady_clock::time_point m_deadline;
+
+    static void assign(State &state, int digit, int cell);
+    static bool apply_singles(State &state, bool &progress);
+    static bool apply_box_line(State &state, bool &progress);
+    static bool propagate(State &state);
+    SolveStatus search();
+
+public:
+    // Loads a legal board of '0'-'9', with '0' for empty cells.
+    void load(const char *board);
+
+    // Solves the loaded board within the limits. The deadline is only looked at if the limits
+    // have a time budget.
+    SolveStatus solve(const SearchLimits &limits, std::chrono::steady_clock::time_point deadline);
+
+    // The solved board, or the deepest state reached when the search stopped early.
+    void get_board(char *board) const;
+
+    long long get_num_guesses() const
+    {
+        return m_num_guesses;
+    }
+
+    // Cells assigned by propagation before the first guess.
+    int get_num_logic_assignments() const
+    {
+        return m_num_logic_assignments;
+    }
+};
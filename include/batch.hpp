@@ -0,0 +1,119 @@
+#pragma once
+#include "journal.hpp"
+#include "latency.hpp"
+#include "puzzle.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * Read-only memory mapping of a whole input file.
+ */
+class InputFile
+{
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+
+public:
+    InputFile() = default;
+    InputFile(const InputFile &) = delete;
+    InputFile &operator=(const InputFile &) = delete;
+    ~InputFile();
+
+    // Maps the file, returns false if it cannot be opened.
+    bool open(const std::string &filepath);
+
+    const char *data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+};
+
+/**
+ * A contiguous range of whole lines of an input file.
+ * first_line_number is the 1-based line number of the line at begin.
+ */
+struct LineRange
+{
+    size_t begin = 0;
+    size_t end = 0;
+    size_t first_line_number = 1;
+};
+
+// Splits the file into shard_count byte ranges, and returns shard's range, moved
+// to line boundaries: a line belongs to the shard its first byte falls into.
+LineRange get_shard_range(const InputFile &input, int shard, int shard_count);
+
+/**
+ * Solves the puzzles in range, writing one "line_number status board" record per puzzle
+ * to results_path. Empty lines are skipped. Returns false if results_path cannot be written.
+ * count_solved and total are incremented, and stats recorded, as puzzles are processed.
+ * With a journal, progress is checkpointed as it goes, and a resumed run keeps the finished
+ * part of results_path and continues from the first unfinished line.
+ */
+bool process_line_range(const InputFile &input, const LineRange &range, const std::string &results_path,
+                        const SearchLimits &limits, const SearchStrategy &strategy,
+                        int &count_solved, int &total, LatencyStats &stats, Journal &journal);
+
+// Solves shard `shard` of `shard_count` of the file, see process_line_range.
+bool process_file_shard(const std::string &filepath, int shard, int shard_count,
+                        const std::string &results_path, const SearchLimits &limits,
+                        const SearchStrategy &strategy, Journal journal);
+
+// Forks `procs` processes that each solve one shard of the file, then merges their
+// results into results_path. A crashed process only loses (part of) its own shard, and
+// with a journal, keeps its shard's results and journal for --resume.
+bool process_file_forked(const std::string &filepath, int procs,
+                         const std::string &results_path, const SearchLimits &limits,
+                         const SearchStrategy &strategy, const Journal &journal);
+
+/**
+ * Fixed-size output records: record i holds the result for the i-th puzzle (non-empty line)
+ * of the input, at offset i * record_size. Bytes 0-80 are the board, byte 81 is the status:
+ * '\n' when solved, so that a fully solved file reads as one solution per line, otherwise
+ * one of the letters below. A 0 status byte means the record has not been written.
+ */
+namespace record
+{
+    const size_t board_size = Puzzle::gridSize * Puzzle::gridSize;
+    const size_t record_size = board_size + 1;
+
+    const char not_written = '\0';
+    const char solved = '\n';
+    const char impossible = 'X';
+    const char timed_out = 'T';
+    const char cancelled = 'C';
+    const char invalid = 'V';
+    const char illegal = 'L';
+
+    char get_status_byte(SolveStatus status);
+}
+
+/**
+ * Offset and length of a puzzle line within the input, without the line terminator.
+ */
+struct PuzzleLine
+{
+    size_t offset;
+    size_t length;
+};
+
+// Indexes the non-empty lines of range.
+std::vector<PuzzleLine> index_puzzle_lines(const InputFile &input, const LineRange &range);
+
+// Solves the puzzles of the file (or of its shard) on `threads` worker threads. Each worker
+// writes its results straight into a preallocated, memory-mapped file of fixed-size records,
+// so results need no ordering buffer and no lock. With a journal, the number of leading
+// records that are all finished is checkpointed, and a resumed run indexes the input from
+// the first unfinished one and skips the records that were finished after it.
+bool process_file_records(const std::string &filepath, const std::string &records_path, int threads,
+                          int shard, int shard_count, const SearchLimits &limits,
+                          const SearchStrategy &strategy, Journal journal);
+
+// Merges result files written by process_line_range into one file ordered by line number.
+bool merge_results(const std::string &out_path, const std::vector<std::string> &inputs);
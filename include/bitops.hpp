@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * Bit manipulation primitives on candidate masks. The scalar helpers are inlined into the hot
+ * loops. The kernels that work on a whole unit or grid are built several times for different
+ * instruction sets, and the best build the CPU supports is chosen once at startup (from cpuid),
+ * so that a single portable binary runs close to native speed everywhere.
+ */
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/**
+ * Builds a hot function that counts candidates three times: for baseline x86-64, where a
+ * popcount is a libgcc call, with POPCNT, and for x86-64-v3 (POPCNT, BMI1/2, LZCNT, AVX2).
+ * The helpers below are inlined into each build. The loader picks the best build the CPU
+ * supports from cpuid before main() runs, independently of --kernels. The compiler does not
+ * emit PEXT or PDEP on its own, so the x86-64-v3 build is fast on every CPU that has it.
+ */
+#define BITOPS_CLONES __attribute__((target_clones("default", "popcnt", "arch=x86-64-v3")))
+#else
+#define BITOPS_CLONES
+#endif
+
+namespace bitops
+{
+    // Number of set bits.
+    inline int popcount(uint16_t mask)
+    {
+        return __builtin_popcount(mask);
+    }
+
+    // Index of the highest set bit, -1 if mask is 0.
+    inline int highest_bit(uint16_t mask)
+    {
+        return mask ? 31 - __builtin_clz(mask) : -1;
+    }
+
+    // Index of the lowest set bit, -1 if mask is 0.
+    inline int lowest_bit(uint16_t mask)
+    {
+        return mask ? __builtin_ctz(mask) : -1;
+    }
+
+    // mask with its lowest set bit cleared.
+    inline uint16_t clear_lowest_bit(uint16_t mask)
+    {
+        return mask & (mask - 1);
+    }
+
+    // Index of the n-th (from 0, lowest first) set bit, n must be less than popcount(mask).
+    inline int select_bit(uint16_t mask, int n)
+    {
+        for (; n > 0; n--)
+        {
+            mask &= mask - 1;
+        }
+        return __builtin_ctz(mask);
+    }
+
+    struct Kernels
+    {
+        const char *name;
+
+        // Takes the candidate masks of the 9 cells of a unit, and writes for each symbol index
+        // the mask of the positions within the unit that have that symbol as a candidate.
+        void (*transpose_unit)(const uint16_t cells[9], uint16_t positions[9]);
+
+        // Writes for each digit index the cells of an 81-character grid that hold that digit
+        // ('1' + index), as three 27-bit band masks: bit (row % 3) * 9 + col of planes[index][row / 3].
+        void (*digit_planes)(const char grid[81], uint32_t planes[9][3]);
+    };
+
+    // The kernels in use. Selected from cpuid before main() runs.
+    extern const Kernels *active;
+
+    // Switches to the kernels with the given name ("generic", "bmi2", "avx2").
+    // Returns false if there is no such build, or if the CPU does not support it.
+    bool select(const std::string &name);
+}
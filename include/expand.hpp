@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * A transform that maps every sudoku to an equivalent one: relabel the digits, permute the rows
+ * within each band and the bands, permute the columns within each stack and the stacks, and
+ * optionally transpose. Every valid (or solvable, or uniquely solvable) puzzle stays so, with
+ * the same logic steps up to relabeling.
+ */
+struct GridTransform
+{
+    // source row and column of every row and column of the result, and the digit map ('0' stays).
+    uint8_t rows[9];
+    uint8_t cols[9];
+    char digits[10];
+    bool transpose;
+};
+
+// 9! digit relabelings, 6^4 row and 6^4 column permutations, and transposing or not.
+const uint64_t num_grid_transforms = 362880ULL * 1679616ULL * 2;
+
+// The index-th transform (index < num_grid_transforms). Distinct indices give distinct transforms.
+GridTransform decode_grid_transform(uint64_t index);
+
+// Writes the transformed puzzle (81 characters '0'-'9') to out.
+void apply_grid_transform(const GridTransform &transform, const char *puzzle, char *out);
+
+/**
+ * Writes count puzzles to output_path, one per line, each a transform of a puzzle of seeds_path
+ * (taken in turn, lines that are not puzzles are skipped). Every output puzzle gets a distinct
+ * transform, an invertible scramble of its index keyed by seed, so the output only depends on
+ * the arguments, and only seed puzzles with symmetries can give repeated puzzles. Every line
+ * is 82 bytes, so puzzle i is at offset i * 82, and threads workers write their share of the
+ * lines straight into the memory-mapped output. Returns false if a file cannot be
+ * read or written, or seeds_path holds no puzzle.
+ */
+bool expand_puzzles(const std::string &seeds_path, long long count, const std::string &output_path,
+                    uint64_t seed, int threads);
@@ -0,0 +1,130 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+/**
+ * Minimal lazy generator coroutine: the body runs up to each co_yield when the
+ * next value is pulled, and stays suspended in between. Destroying the generator
+ * destroys the suspended body, which stops it early.
+ *
+ *     for (auto value : generator) { ... }
+ */
+template <typename T>
+class Generator
+{
+public:
+    struct promise_type
+    {
+        const T *current = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object()
+        {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(const T &value) noexcept
+        {
+            current = &value;
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    class iterator
+    {
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        explicit iterator(std::coroutine_handle<promise_type> handle) : m_handle(handle)
+        {
+        }
+
+        const T &operator*() const
+        {
+            return *m_handle.promise().current;
+        }
+
+        iterator &operator++()
+        {
+            resume(m_handle);
+            return *this;
+        }
+
+        bool operator==(std::default_sentinel_t) const
+        {
+            return !m_handle || m_handle.done();
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+
+    explicit Generator(std::coroutine_handle<promise_type> handle) : m_handle(handle)
+    {
+    }
+
+    static void resume(std::coroutine_handle<promise_type> handle)
+    {
+        handle.resume();
+        if (handle.promise().exception)
+        {
+            std::rethrow_exception(handle.promise().exception);
+        }
+    }
+
+public:
+    Generator(const Generator &) = delete;
+    Generator &operator=(const Generator &) = delete;
+
+    Generator(Generator &&other) noexcept : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+
+    ~Generator()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    iterator begin()
+    {
+        if (m_handle)
+        {
+            resume(m_handle);
+        }
+        return iterator(m_handle);
+    }
+
+    std::default_sentinel_t end()
+    {
+        return std::default_sentinel;
+    }
+};
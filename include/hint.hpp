@@ -0,0 +1,100 @@
+#pragma once
+#include "zones.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Deduction rules a hint can come from, cheapest first.
+ * naked_single: the cell has a single candidate.
+ * hidden_single_*: the cell is the only one of its row, column or box that can hold the digit.
+ * box_line: the digit's candidates in a box all lie in one row or column, so the rest of
+ *   that row or column cannot hold it.
+ */
+enum class StepRule
+{
+    naked_single,
+    hidden_single_row,
+    hidden_single_col,
+    hidden_single_box,
+    box_line
+};
+
+const char *get_step_rule_name(StepRule rule);
+
+/**
+ * A single deduction. Singles assign symbol to cell. A box_line step removes symbol from the
+ * candidates of the eliminated cells of line (a row or column zone) outside box (a box zone),
+ * and cell is the first of them.
+ */
+struct Step
+{
+    const static int max_eliminations = 6;
+
+    StepRule rule;
+    char symbol;
+    uint8_t cell;
+    uint8_t box;
+    uint8_t line;
+    uint8_t num_eliminated;
+    uint8_t eliminated[max_eliminations];
+};
+
+/**
+ * Next-move hints for a puzzle that is being solved by hand. The session keeps the candidates
+ * of every cell, and for every zone and digit the positions in the zone that can still hold
+ * the digit, and updates both for each assignment or elimination, so that finding the next
+ * step is one pass over the cached masks instead of recomputing the candidates.
+ */
+class HintSession
+{
+private:
+    char m_board[zones::num_cells];
+    uint16_t m_candidates[zones::num_cells];
+
+    // m_positions[zone][digit] has bit p set if zones::tables.cells[zone][p] can hold the digit.
+    uint16_t m_positions[zones::num_zones][zones::grid_size];
+    int m_num_unassigned = 0;
+
+    void eliminate(int cell, int digit);
+
+public:
+    /**
+     * Starts a session on the puzzle (81 characters '0'-'9'). Returns false if the puzzle is
+     * malformed, or has a digit twice in a zone.
+     */
+    bool load(const char *puzzle, size_t length);
+
+    /**
+     * Finds the cheapest step the rules allow, in the order of StepRule, and within a rule the
+     * first one in cell (or zone) order. Returns false if the board is complete, or no rule
+     * applies: the puzzle then needs guessing, or a placed digit was wrong.
+     */
+    bool next_step(Step &step) const;
+
+    // Applies a step returned by next_step.
+    void apply(const Step &step);
+
+    // Places a digit ('1'-'9') the user chose. Returns false if it is not a candidate of the cell.
+    bool place(int cell, char symbol);
+
+    bool is_solved() const
+    {
+        return m_num_unassigned == 0;
+    }
+
+    // The candidates of the cell, bit d for digit d + 1.
+    uint16_t get_candidates(int cell) const
+    {
+        return m_candidates[cell];
+    }
+
+    std::string_view get_board() const
+    {
+        return std::string_view(m_board, zones::num_cells);
+    }
+};
+
+// Prints the steps that solve the puzzle as far as the rules go, followed by the board.
+// Returns false if the puzzle is invalid or illegal.
+bool print_hints(const std::string &puzzle);
@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * Progress of a batch run over the byte range [range_begin, range_end) of an input file:
+ * the puzzles before input_offset are finished.
+ */
+struct Progress
+{
+    // a journal is only resumed over the same input and range.
+    size_t input_size = 0;
+    size_t range_begin = 0;
+    size_t range_end = 0;
+
+    // byte offset and line number of the first unfinished line.
+    size_t input_offset = 0;
+    size_t line_number = 1;
+
+    // finished puzzles (non-empty lines), and how many of them were solved.
+    long long total = 0;
+    long long count_solved = 0;
+
+    // bytes of the results file that hold the finished puzzles.
+    size_t results_size = 0;
+};
+
+/**
+ * Progress file of a batch run (--journal), rewritten at most once per checkpoint_interval,
+ * from which --resume continues an interrupted run. A checkpoint is written to a temporary
+ * file and renamed over the journal, so the journal always holds a complete checkpoint, and
+ * it is written after the results it covers have been handed to the OS: it survives the
+ * process dying, not the machine.
+ */
+class Journal
+{
+private:
+    std::string m_path;
+    bool m_resume = false;
+    bool m_resumed = false;
+    std::chrono::steady_clock::time_point m_next_checkpoint;
+
+public:
+    static constexpr std::chrono::milliseconds checkpoint_interval{1000};
+
+    Journal() = default;
+    Journal(const std::string &path, bool resume);
+
+    bool is_enabled() const
+    {
+        return !m_path.empty();
+    }
+
+    const std::string &get_path() const
+    {
+        return m_path;
+    }
+
+    // The journal of shard `shard` of a forked run.
+    Journal for_shard(int shard) const;
+
+    /**
+     * With --resume, replaces progress, which describes a fresh start, with the journaled one.
+     * Does nothing if not resuming or if the journal does not exist yet. Returns false, after
+     * printing why, if the journal cannot be read or belongs to another input or range.
+     */
+    bool load(Progress &progress);
+
+    // Whether load found a journal to resume from.
+    bool is_resumed() const
+    {
+        return m_resumed;
+    }
+
+    // Whether checkpoint_interval has passed since the last checkpoint.
+    bool is_due() const
+    {
+        return is_enabled() && std::chrono::steady_clock::now() >= m_next_checkpoint;
+    }
+
+    // Writes progress to the journal, returns false if it cannot be written.
+    bool checkpoint(const Progress &progress);
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "puzzle.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Histogram of durations with log-sized buckets, in the style of HdrHistogram: every power
+ * of two range is split into sub_bucket_count equal buckets, so that any recorded value is
+ * known to within 1 / sub_bucket_count (about 3%), from nanoseconds up to centuries,
+ * in a fixed 15 KB.
+ */
+class LatencyHistogram
+{
+public:
+    const static int sub_bucket_bits = 5;
+    const static int sub_bucket_count = 1 << sub_bucket_bits;
+    const static int num_buckets = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+private:
+    uint64_t m_counts[num_buckets] = {};
+    uint64_t m_total = 0;
+    uint64_t m_max = 0;
+
+    static int get_bucket(uint64_t value);
+
+    // The largest value that falls into the bucket.
+    static uint64_t get_bucket_limit(int bucket);
+
+public:
+    void record(uint64_t value);
+    void merge(const LatencyHistogram &other);
+
+    uint64_t count() const
+    {
+        return m_total;
+    }
+
+    uint64_t max() const
+    {
+        return m_max;
+    }
+
+    // The smallest bucket limit that at least percentile % of the values are at or below.
+    uint64_t value_at_percentile(double percentile) const;
+};
+
+/**
+ * Solve times of a batch: a histogram of all of them, and the slowest puzzles, which
+ * capture_slowest() turns on for the whole process.
+ */
+class LatencyStats
+{
+public:
+    struct SlowPuzzle
+    {
+        uint64_t nanoseconds;
+        long long guesses;
+        SolveStatus status;
+        char puzzle[81];
+        char board[81];
+    };
+
+private:
+    LatencyHistogram m_histogram;
+
+    // min-heap on nanoseconds, so that the fastest of the slowest is the one to replace.
+    std::vector<SlowPuzzle> m_slowest;
+
+    static size_t s_slowest_count;
+    static std::string s_slowest_path;
+
+    void add_slow_puzzle(const SlowPuzzle &slow);
+
+public:
+    // Keeps the count slowest puzzles of every batch, to be written to path by report().
+    static void capture_slowest(size_t count, const std::string &path);
+
+    // Records the last solve() of puzzle, which was loaded from puzzle_str. Puzzles that
+    // were never searched (invalid or illegal) are not recorded.
+    void record(const char *puzzle_str, SolveStatus status, Puzzle &puzzle);
+
+    void merge(const LatencyStats &other);
+
+    // Prints p50, p90, p99, p99.9 and max, and writes the slowest puzzles, slowest first,
+    // to the capture_slowest() path followed by suffix, one "puzzle board status guesses
+    // microseconds" line each. Returns false if that file could not be written.
+    bool report(const std::string &suffix = "");
+};
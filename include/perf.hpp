@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Optional hardware performance counters (Linux perf_event_open) around the phases of
+ * solving. Each thread opens its own counters the first time it enters a phase, and every
+ * scope adds what the counters advanced to process-wide totals. If the kernel refuses the
+ * counters (no PMU, or perf_event_paranoid), the scopes quietly count nothing.
+ */
+namespace perf
+{
+    enum class Phase
+    {
+        logic,
+        backtracking,
+        io
+    };
+    const int num_phases = 3;
+
+    enum class Counter
+    {
+        cycles,
+        instructions,
+        branch_misses,
+        l1d_misses,
+        llc_misses
+    };
+    const int num_counters = 5;
+
+    // Turns the instrumentation on, it is off by default and then costs a single branch per scope.
+    void enable();
+    bool is_enabled();
+
+    // Counts the enclosed code towards a phase, on the calling thread. Scopes must not nest.
+    class Scope
+    {
+    private:
+        Phase m_phase;
+        bool m_active = false;
+        uint64_t m_start[num_counters] = {};
+
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // Prints the totals per phase, or that no counters were available.
+    void print_report();
+}
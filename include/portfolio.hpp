@@ -0,0 +1,23 @@
+#pragma once
+#include "puzzle.hpp"
+
+/**
+ * Portfolio solving (--portfolio k): no single configuration is best on every puzzle, so a
+ * puzzle that the configured strategy cannot solve within its guess budget is handed to k
+ * configurations at once, each on its own thread and its own solver context. Every thread that
+ * races puzzles starts its k member threads once, and hands them each race. The first member
+ * to solve or refute the puzzle sets the race flag of the others' SearchLimits, which stops
+ * them at their next limit check.
+ *
+ * The members differ in engine, branching, value order, restarts and logic rules. Members past
+ * the listed ones are randomized restarting searches with different seeds. They search without
+ * a transposition table, so that a race does not allocate one per thread.
+ */
+namespace portfolio
+{
+    // The strategy of member `member`, derived from the configured strategy (seed and rules).
+    SearchStrategy get_member_strategy(int member, const SearchStrategy &base);
+
+    // A short description of the member's configuration.
+    const char *get_member_name(int member);
+}
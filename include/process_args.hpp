@@ -1,6 +1,57 @@
+#pragma once
+#include "puzzle.hpp"
+#include <atomic>
 #include <string>
 
+/**
+ * Long options (--name value) that can be given anywhere on the command line.
+ */
+struct Options
+{
+    SearchLimits limits;
+
+    // --engine, --value-order, --seed, --restarts, --table-mb and --rules.
+    SearchStrategy strategy;
+
+    // --shard i/N: only solve the i-th of N byte ranges of the file.
+    int shard_index = 0;
+    int shard_count = 0;
+
+    // --procs N: solve the file in N forked processes.
+    int procs = 0;
+
+    // --results path: write compact "line_number status board" records instead of printing.
+    std::string results_path;
+
+    // --records path: write fixed-size records into a memory-mapped file, see batch.hpp.
+    std::string records_path;
+
+    // --threads N: worker threads for --records.
+    int threads = 1;
+
+    // --journal path: checkpoint the progress of a -f run, see journal.hpp.
+    std::string journal_path;
+
+    // --resume: continue the -f run recorded in the journal.
+    bool resume = false;
+
+    // --store path: persistent solution store checked before solving, see store.hpp.
+    std::string store_path;
+
+    // --store-mb N: size of the solution store when it is created.
+    long long store_megabytes = 64;
+
+    // --solutions N: print up to N solutions per puzzle (0 for all) instead of the first one.
+    long long max_solutions = -1;
+};
+
+extern Options options;
+
+// Set from the SIGINT handler, cancels the puzzle being solved and the rest of the batch.
+extern std::atomic<bool> cancel_requested;
+
 void parse_args(int argc, char *argv[]);
 void process_args();
 void illegal_option(std::string arg);
+void print_success_statistic(int count_solved, int total);
 void process_file(std::string filepath);
@@ -1,9 +1,161 @@
 #pragma once
 
+#include "generator.hpp"
+#include "transposition.hpp"
 #include "util.hpp"
-#include <regex>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+
+/**
+ * Outcome of a solve attempt. timed_out and cancelled mean that the search was stopped
+ * before it could decide whether the puzzle has a solution. invalid and illegal are only
+ * returned by solve_puzzle_string, for input that was never searched.
+ */
+enum class SolveStatus
+{
+    solved,
+    impossible,
+    timed_out,
+    cancelled,
+    invalid,
+    illegal
+};
+
+const char *get_status_name(SolveStatus status);
+
+/**
+ * Budget for a single solve. A zero limit means unlimited. The limits are checked
+ * inside the backtracking loop once every check_interval guesses, so that the
+ * checks cost next to nothing compared to the search itself.
+ */
+struct SearchLimits
+{
+    const static int check_interval = 1024;
+
+    // Maximum amount of backtracking guesses.
+    long long max_guesses = 0;
+
+    // Maximum wall-clock time spent in solve().
+    std::chrono::nanoseconds time_budget = std::chrono::nanoseconds::zero();
+
+    // External cancellation token. When it becomes true, the search stops.
+    const std::atomic<bool> *cancel = nullptr;
+
+    // Set by the first member of a portfolio race to finish, stops the other members.
+    const std::atomic<bool> *race = nullptr;
+};
+
+// Returns timed_out or cancelled if a search that made num_guesses guesses, and has to finish
+// by deadline if limits have a time budget, has to stop, solved otherwise.
+SolveStatus check_search_limits(const SearchLimits &limits, long long num_guesses,
+                                std::chrono::steady_clock::time_point deadline);
+
+/**
+ * Order in which the backtracking search tries the candidates of a cell.
+ * descending: largest symbol first.
+ * least_constraining: the symbol that is a candidate of the fewest unassigned peers first,
+ *   ties broken at random.
+ * random: uniformly at random.
+ */
+enum class ValueOrder
+{
+    descending,
+    least_constraining,
+    random
+};
+
+// Parses "descending", "lcv" or "random", returns false for anything else.
+bool parse_value_order(const std::string &name, ValueOrder &order);
+
+/**
+ * Solving engine. classic: the Puzzle's own logic rules and backtracking, over per-cell
+ * candidate masks. band: BandSolver, over per-digit band bitboards (see band.hpp), which
+ * ignores the value order, restarts and the transposition table.
+ */
+enum class Engine
+{
+    classic,
+    band
+};
+
+// Parses "classic" or "band", returns false for anything else.
+bool parse_engine(const std::string &name, Engine &engine);
+
+/**
+ * Cell the classic backtracking search guesses in next.
+ * first: the first unassigned cell in row-major order.
+ * fewest: the unassigned cell with the fewest candidates (minimum remaining values), which
+ *   costs a scan of the board per guess but usually makes far fewer guesses.
+ */
+enum class Branching
+{
+    first,
+    fewest
+};
+
+// Parses "first" or "mrv", returns false for anything else.
+bool parse_branching(const std::string &name, Branching &branching);
+
+/**
+ * Logic rules of the classic engine.
+ * singles: assigns cells with a single candidate.
+ * hidden: assigns a digit to the only cell of a zone that can hold it.
+ * boxline: when a digit's candidates in a box all lie in one row or column, removes the digit
+ * from the rest of that row or column.
+ */
+enum class LogicRule
+{
+    singles,
+    hidden,
+    boxline
+};
+const int num_logic_rules = 3;
+
+const char *get_logic_rule_name(LogicRule rule);
+
+/**
+ * The rules the logic phase applies, in order, in rounds until a round changes nothing.
+ */
+struct LogicPipeline
+{
+    LogicRule rules[num_logic_rules] = {LogicRule::singles, LogicRule::hidden, LogicRule::boxline};
+    int count = num_logic_rules;
+};
+
+// Parses a comma-separated list of rule names such as "singles,hidden,boxline", or "none" for
+// no logic phase at all. Returns false for unknown or repeated names.
+bool parse_logic_pipeline(const std::string &names, LogicPipeline &pipeline);
+
+/**
+ * How the backtracking search explores. With a restart_unit, the search restarts from
+ * scratch after restart_unit * luby(i) guesses in its i-th run (1, 1, 2, 1, 1, 2, 4, ...),
+ * continuing the random sequence, which cuts off the heavy tail of unlucky orderings.
+ * Restarts only make sense with a randomized value order.
+ */
+struct SearchStrategy
+{
+    Engine engine = Engine::classic;
+    Branching branching = Branching::first;
+    ValueOrder value_order = ValueOrder::descending;
+    uint64_t seed = 1;
+
+    // Guesses in the first run of the search, 0 disables restarts.
+    long long restart_unit = 0;
+
+    // Size of the transposition table of dead boards, 0 disables it. See TranspositionTable.
+    long long table_megabytes = 0;
+
+    // Logic rules of the classic engine, applied before the search.
+    LogicPipeline rules;
+
+    // Portfolio solving (see portfolio.hpp): with 2 or more threads, a puzzle that takes more
+    // than portfolio_budget guesses is raced by that many configurations instead.
+    int portfolio_threads = 0;
+    long long portfolio_budget = 10000;
+};
 
 /**
  * Class that represents a sudoku puzzle. Contains the board representation, as well
@@ -17,7 +169,6 @@ public:
     const static int numSymbols = 9;
     const static int squareSize = 3;
     const static int num_printout_dashes = (gridSize * 4) + 1;
-    const static std::regex puzzle_regex;
     const static std::string puzzle_regex_str;
 
 private:
@@ -27,27 +178,68 @@ private:
     // The total amount of guesses made during backtracking.
     int m_num_backtracking_guesses = 0;
 
+    // Budget for solve(), and the point in time at which the current solve() runs out of it.
+    SearchLimits m_limits;
+    std::chrono::steady_clock::time_point m_deadline;
+
+    // Wall-clock time the last solve() took.
+    std::chrono::nanoseconds m_solve_time = std::chrono::nanoseconds::zero();
+
+    // Value order and restart policy, and the search's random state and restart bookkeeping.
+    SearchStrategy m_strategy;
+    uint64_t m_random_state = 1;
+    int m_num_restarts = 0;
+    long long m_restart_budget = 0;
+    long long m_guesses_at_restart = 0;
+
+    // Zobrist hash of m_board, kept up to date during the search, and the table of dead
+    // boards it is looked up in (not owned, nullptr if disabled), with its hit and miss counts.
+    uint64_t m_board_hash = 0;
+    TranspositionTable *m_table = nullptr;
+    bool m_search_uses_table = false;
+    long long m_num_table_hits = 0;
+    long long m_num_table_misses = 0;
+
     // m_board is the sudoku grid. unassigned cells are '0', assigned cells are '1'-'9'.
     // in retrospect, making these chars was a mistake. they should just be int8_t.
     char m_board[gridSize][gridSize] = {};
 
+    // The clues the puzzle was loaded with, as changed by edit_clue().
+    char m_clues[gridSize][gridSize] = {};
+
     // m_candidates[i][j] contains a bitset. if the ith bit is set, it means that the symbol i is
     // a possible candidate for cell m_board[i][j].
     // if m_candidates[i][j] == 0 && m_board[i][j] == '0', then we have reached a conflict during backtracking
     uint16_t m_candidates[gridSize][gridSize] = {};
 
-    // m_backtrack_candidates_removed[i][j] contains the set of cells (flat index representation)
-    // that had the symbol currently at m_board[i][j] removed from their
-    // candidate set at m_candidates[cell].
+    // m_backtrack_candidates_removed[i][j] contains the set of peers (bit k is set for
+    // zones::tables.peers[cell][k]) that had the symbol currently at m_board[i][j] removed
+    // from their candidate set at m_candidates[peer].
     // This is necessary so that backtracking can fully undo state changes after a path fails,
     // while trying to do as little work as possible.
-    std::unordered_set<size_t> m_backtrack_candidates_removed[gridSize][gridSize] = {};
+    uint32_t m_backtrack_candidates_removed[gridSize][gridSize] = {};
+
+    // The guesses of the current search, in the order they were made. At most one per cell.
+    // untried holds the candidates of the cell that have not been tried yet.
+    struct Guess
+    {
+        uint8_t cell;
+        char symbol;
+        uint16_t untried;
+    };
+    Guess m_guess_stack[gridSize * gridSize] = {};
+    int m_num_guesses_on_stack = 0;
+
+    // How the last continue_search() ended.
+    SolveStatus m_search_status = SolveStatus::impossible;
+
+    // The portfolio member whose result the last solve() took, -1 if it took none.
+    int m_portfolio_winner = -1;
 
 public:
     Puzzle(const char *puzzle_str)
     {
-        memcpy(m_board, puzzle_str, sizeof(m_board));
-        memset(m_candidates, 0, sizeof(m_candidates));
+        reset(puzzle_str);
     }
 
     Puzzle()
@@ -56,12 +248,41 @@ public:
         memset(m_candidates, 0, sizeof(m_candidates));
     }
 
-    Puzzle(std::string puzzle_str)
+    Puzzle(const std::string &puzzle_str) : Puzzle(puzzle_str.c_str())
+    {
+    }
+
+    /**
+     * Loads a new puzzle into this object, discarding all state from the previous one.
+     * Allows a Puzzle to be reused for a whole batch without any heap allocation.
+     */
+    void reset(const char *puzzle_str)
     {
-        memcpy(m_board, puzzle_str.c_str(), sizeof(m_board));
+        memcpy(m_board, puzzle_str, sizeof(m_board));
+        memcpy(m_clues, puzzle_str, sizeof(m_clues));
         memset(m_candidates, 0, sizeof(m_candidates));
+        memset(m_backtrack_candidates_removed, 0, sizeof(m_backtrack_candidates_removed));
+        m_num_guesses_on_stack = 0;
+        m_num_restarts = 0;
+        m_num_table_hits = 0;
+        m_num_table_misses = 0;
+        m_num_logic_assignments = 0;
+        m_num_backtracking_guesses = 0;
+        m_portfolio_winner = -1;
+        m_solve_time = std::chrono::nanoseconds::zero();
+    }
+
+    // Shows a result that was found without solving (see SolutionStore) as the current board,
+    // with solve_time as the time it took.
+    void load_stored_result(const char *board, std::chrono::nanoseconds solve_time)
+    {
+        memcpy(m_board, board, sizeof(m_board));
+        m_solve_time = solve_time;
     }
 
+    // Checks that the string has the puzzle_regex_str format, i.e. is 81 digits.
+    static bool is_valid_puzzle_string(const char *puzzle_str, size_t length);
+
     int get_num_logic_assignments()
     {
         return m_num_logic_assignments;
@@ -72,14 +293,77 @@ public:
         return m_num_backtracking_guesses;
     }
 
+    // How the search behind the last solutions() ended: impossible once all solutions
+    // were found, timed_out or cancelled if the limits ran out first.
+    SolveStatus get_search_status()
+    {
+        return m_search_status;
+    }
+
+    std::chrono::nanoseconds get_solve_time()
+    {
+        return m_solve_time;
+    }
+
+    // The portfolio member that solved (or refuted) the puzzle, -1 if the default path did.
+    int get_portfolio_winner()
+    {
+        return m_portfolio_winner;
+    }
+
+    int get_num_restarts()
+    {
+        return m_num_restarts;
+    }
+
+    // Lookups of the transposition table that found a dead board, and that did not.
+    long long get_num_table_hits()
+    {
+        return m_num_table_hits;
+    }
+
+    long long get_num_table_misses()
+    {
+        return m_num_table_misses;
+    }
+
+    // Table shared by the searches of this puzzle, nullptr to search without one.
+    void set_transposition_table(TranspositionTable *table)
+    {
+        m_table = table;
+    }
+
+    void set_limits(const SearchLimits &limits)
+    {
+        m_limits = limits;
+    }
+
+    void set_strategy(const SearchStrategy &strategy)
+    {
+        m_strategy = strategy;
+    }
+
 public:
     void print_board();
     std::string get_puzzle_string();
+    std::string_view get_puzzle_string_view();
     ScientificNotation num_possible_permutations();
     size_t count_unassigned_cells();
     bool is_legal();
 
 private:
+    // Flat views of m_board and m_candidates, indexed by cell = row * gridSize + col,
+    // for iterating over the zones:: tables.
+    char *board_cells()
+    {
+        return reinterpret_cast<char *>(m_board);
+    }
+
+    uint16_t *candidate_cells()
+    {
+        return reinterpret_cast<uint16_t *>(m_candidates);
+    }
+
     void print_candidates(uint8_t i, uint8_t j);
     void print_all_candidates();
 
@@ -89,14 +373,36 @@ private:
     void calculate_candidates_for_constraint_zone(int x, int y);
     void calculate_all_candidates();
     void remove_symbol_from_candidates_in_constraint_zones(uint8_t i, uint8_t j, char symbol);
-    void narrow_down_candidates();
+    int narrow_down_candidates();
 
-    // Functions that perform symbol assignment based on candidate sets.
-    void assign_simple_candidates();
-    void find_and_assign_exclusive_candidates();
+    // Functions that perform symbol assignment based on candidate sets, returning the amount of assignments.
+    int assign_simple_candidates();
+    int find_and_assign_exclusive_candidates();
 
     // Function to be called in a loop to solve the puzzle using logic rules.
-    uint8_t apply_logic_rules();
+    int apply_logic_rules();
+
+    // Checks the search limits, returns solved if the search may continue.
+    SolveStatus check_limits();
+
+    // solve() with the strategy's engine, without the portfolio.
+    SolveStatus solve_with_strategy();
+
+    // solve() with the band engine, see band.cpp.
+    SolveStatus solve_with_bands();
+
+    // solve() with a portfolio race once the default path runs out of budget, see portfolio.cpp.
+    SolveStatus solve_with_portfolio();
+
+    // Steps of the backtracking search, see backtrack.cpp.
+    bool start_search(bool enumerate = false);
+    bool push_guess(uint8_t cell, char symbol, uint16_t untried);
+    Guess pop_guess();
+    char choose_symbol(uint8_t cell, uint16_t untried);
+    uint64_t next_random();
+    void restart_search();
+    int find_fewest_candidates_cell();
+    SolveStatus continue_search(bool resume);
 
 public:
     // Tries to use logic rules to solve the puzzle, returns true if solved,
@@ -104,10 +410,55 @@ public:
     bool try_to_solve_logically();
 
     // Catch-all function that solves any puzzle using good ol' backtracking.
-    bool backtracking();
+    SolveStatus backtracking();
+
+    // Tries to solve it logically, and then tries backtracking, within the search limits.
+    SolveStatus solve();
+
+    // Lazily enumerates the solutions, one per pull, keeping the search suspended in
+    // between. Each yielded board is only valid until the next pull. Stops early when
+    // the generator is destroyed, or when the search limits run out.
+    Generator<std::string_view> solutions();
 
-    // Tries to solve it logically, and then tries backtracking.
-    bool solve();
+    // Adds, changes or (with symbol '0') removes the clue at (row, col) of a solved puzzle,
+    // and updates the solution. Keeps the current solution when it still fits, otherwise
+    // re-solves the zones of the cell from the current state, and only falls back to
+    // solving from the clues if that fails.
+    SolveStatus edit_clue(uint8_t row, uint8_t col, char symbol);
 };
 
-bool process_puzzle(std::string puzzle_str, int count);
\ No newline at end of file
+class LatencyStats;
+
+/**
+ * Per-thread solver state that is reused from one puzzle to the next,
+ * so that batch runs do no steady-state heap allocation.
+ */
+struct SolverContext
+{
+    Puzzle puzzle;
+    TranspositionTable table;
+};
+
+// The calling thread's solver context.
+SolverContext &get_solver_context();
+
+// Loads the puzzle into the calling thread's solver context, and returns the context's puzzle.
+Puzzle &load_puzzle(const char *puzzle_str, const SearchLimits &limits, const SearchStrategy &strategy);
+
+// Solves the loaded puzzle, or takes its result from the solution store if the store is enabled
+// and has it, which from_store tells. Solved and impossible results are added to the store.
+SolveStatus solve_loaded_puzzle(Puzzle &puzzle, const char *puzzle_str, bool &from_store);
+
+// Validates and solves a puzzle with the calling thread's solver context, without printing.
+// The solved (or partially solved) board and stats are left in get_solver_context().puzzle.
+SolveStatus solve_puzzle_string(const char *puzzle_str, size_t length, const SearchLimits &limits,
+                                const SearchStrategy &strategy = SearchStrategy());
+
+// Prints up to max_solutions solutions of the puzzle (all of them if 0), as they are found.
+bool enumerate_puzzle(const std::string &puzzle_str, int count, long long max_solutions,
+                      const SearchLimits &limits = SearchLimits(),
+                      const SearchStrategy &strategy = SearchStrategy());
+
+// Solves and pretty-prints the puzzle, and records its solve time in stats, if given.
+bool process_puzzle(const std::string &puzzle_str, int count, const SearchLimits &limits = SearchLimits(),
+                    const SearchStrategy &strategy = SearchStrategy(), LatencyStats *stats = nullptr);
\ No newline at end of file
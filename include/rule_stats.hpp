@@ -0,0 +1,21 @@
+#pragma once
+#include "puzzle.hpp"
+#include <chrono>
+
+/**
+ * Optional cost/benefit accounting of the logic rules: for every rule, how often it ran, the
+ * time it took, and the assignments and eliminations it made, summed over all threads. The
+ * time per change shows which rules pay for themselves on a given kind of puzzle.
+ */
+namespace rule_stats
+{
+    // Turns the accounting on, it is off by default and then costs a single branch per rule.
+    void enable();
+    bool is_enabled();
+
+    // Adds one application of rule.
+    void record(LogicRule rule, std::chrono::nanoseconds time, int assignments, int eliminations);
+
+    // Prints the totals per rule, if anything was recorded.
+    void print_report();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "puzzle.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Persistent solution store (--store): an open-addressing hash table of solved and impossible
+ * puzzles in a memory-mapped file, so that runs over overlapping inputs only solve each puzzle
+ * once, and a lookup costs no system call.
+ *
+ * Every slot holds a puzzle and its solution packed two digits per byte, the status, and the
+ * guesses and time the original solve took. A puzzle is looked for in the max_probes slots
+ * after its Zobrist hash. When they are all taken, an insert evicts the least recently used
+ * of them (by the run it was last used in), and among those the cheapest one to solve again.
+ *
+ * Any number of processes may read the store while one writes it. The writer holds an
+ * exclusive flock on the file, processes that cannot get it only read. Each slot is guarded
+ * by a sequence lock: the writer makes the sequence odd while it rewrites a slot, and a
+ * reader copies the slot and retries if the sequence was odd or changed meanwhile.
+ */
+class SolutionStore
+{
+public:
+    const static int max_probes = 8;
+    const static int packed_size = (Puzzle::gridSize * Puzzle::gridSize + 1) / 2;
+
+    // Slots are only read and written as whole 64-bit words, the first of which is the sequence.
+    struct Slot
+    {
+        uint64_t sequence;
+        // the last run (generation) that used the slot, 0 if it is empty.
+        uint32_t last_used;
+        uint32_t guesses;
+        uint64_t hash;
+        uint32_t microseconds;
+        uint8_t status;
+        uint8_t puzzle[packed_size];
+        uint8_t board[packed_size];
+        uint8_t padding[128 - 29 - 2 * packed_size];
+    };
+    static_assert(sizeof(Slot) == 128, "slots are two cache lines");
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t slot_size;
+        uint64_t slot_count;
+        // incremented by every run that opens the store for writing.
+        uint32_t generation;
+        uint8_t padding[128 - 28];
+    };
+    static_assert(sizeof(Header) == 128, "slots start on a cache line");
+
+    /**
+     * A stored result. board is the solution if status is solved, and the puzzle otherwise.
+     */
+    struct Entry
+    {
+        SolveStatus status;
+        uint32_t guesses;
+        uint32_t microseconds;
+        char board[Puzzle::gridSize * Puzzle::gridSize];
+    };
+
+private:
+    std::string m_path;
+    long long m_megabytes = 0;
+    std::once_flag m_opened;
+
+    int m_fd = -1;
+    char *m_mapping = nullptr;
+    size_t m_size = 0;
+    Header *m_header = nullptr;
+    Slot *m_slots = nullptr;
+    uint64_t m_index_mask = 0;
+    bool m_writer = false;
+    uint32_t m_generation = 0;
+    std::mutex m_write_mutex;
+
+    void open();
+    bool map_file(bool writer);
+
+public:
+    SolutionStore() = default;
+    SolutionStore(const SolutionStore &) = delete;
+    SolutionStore &operator=(const SolutionStore &) = delete;
+    ~SolutionStore();
+
+    /**
+     * Uses the store at path, created with a size of about megabytes if it does not exist yet
+     * (an existing store keeps its size). The file is only opened by the first lookup, so that
+     * each forked process takes (or fails to take) the writer lock for itself.
+     */
+    void configure(const std::string &path, long long megabytes);
+
+    bool is_enabled() const
+    {
+        return !m_path.empty();
+    }
+
+    // Looks the puzzle (81 characters '0'-'9') up, returns true and fills entry if it is stored.
+    bool lookup(const char *puzzle, Entry &entry);
+
+    // Stores the result of solving the puzzle, if this process is the writer.
+    void insert(const char *puzzle, const Entry &entry);
+
+    // Prints how many lookups hit and missed, and how many entries were inserted and evicted.
+    void print_report();
+};
+
+// The store configured with --store.
+SolutionStore &get_solution_store();
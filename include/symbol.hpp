@@ -1,7 +1,9 @@
-
 #pragma once
+#include "bitops.hpp"
 #include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 
 namespace symbol
 {
@@ -11,8 +13,48 @@ namespace symbol
     const size_t uint16_bits = std::numeric_limits<uint16_t>::digits;
     const size_t uint32_bits = std::numeric_limits<uint32_t>::digits;
 
-    uint8_t get_symbol_index(char symbol);
-    uint16_t get_symbol_mask(char symbol);
-    char get_first_symbol_from_mask(uint16_t candidate_mask);
-    char get_next_symbol_from_mask(uint16_t candidate_mask, char prev_symbol);
+    /**
+     * Get the index of the symbol w.r.t it's domain.
+     * i.e. '1' -> 0, '2' -> 1, ... '9' -> 8
+     */
+    inline uint8_t get_symbol_index(char symbol)
+    {
+        return symbol - '1';
+    }
+
+    /**
+     * Returns a 16-bit integer that has only the i_th bit set,
+     * with i being the index of the symbol.
+     * Note: Symbols start from 1, but their indeces start from 0.
+     * get_symbol_mask('2') -> 0b0000000000000010
+     * get_symbol_mask('9') -> 0b0000000100000000
+     */
+    inline uint16_t get_symbol_mask(char symbol)
+    {
+        return 1UL << get_symbol_index(symbol);
+    }
+
+    /**
+     * Returns the largest symbol from the candidate set.
+     */
+    inline char get_first_symbol_from_mask(uint16_t candidate_set)
+    {
+        return unassigned_symbol + (bitops::highest_bit(candidate_set) + 1);
+    }
+
+    /**
+     * Returns the next largest symbol after @arg{symbol} from the candidate set.
+     */
+    inline char get_next_symbol_from_mask(uint16_t candidate_set, char symbol)
+    {
+        if (symbol == unassigned_symbol)
+        {
+            return get_first_symbol_from_mask(candidate_set);
+        }
+        // mask out bits including/higher than symbol
+        size_t num_bits_to_shift = symbol - unassigned_symbol;
+        uint16_t mask = 0xFFFF >> ((symbol::uint16_bits - num_bits_to_shift) + 1);
+
+        return get_first_symbol_from_mask(mask & candidate_set);
+    }
 }
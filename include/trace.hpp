@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * Optional timeline of what each thread spends its time on, written as a Chrome trace-event
+ * file (open it in Perfetto or chrome://tracing). Every thread records its spans into its own
+ * fixed-size ring buffer, without locking, so that a long run keeps its most recent spans.
+ * Buffers of exited threads are reused by the threads started after them.
+ */
+namespace trace
+{
+    enum class Span
+    {
+        read,
+        validate,
+        logic,
+        backtracking,
+        write
+    };
+
+    // Spans kept per thread, older ones are overwritten.
+    const size_t ring_capacity = 1 << 18;
+
+    // Starts recording, to be written to path by write_file(). Off by default, and then a
+    // span costs a single branch.
+    void enable(const std::string &path);
+    bool is_enabled();
+
+    // Sets the puzzle that the calling thread's next spans belong to. Spans record it as an argument.
+    void set_puzzle(long long index);
+
+    // Records the enclosed code as a span on the calling thread.
+    class Scope
+    {
+    private:
+        Span m_span;
+        bool m_active;
+        uint64_t m_start_ns = 0;
+
+    public:
+        explicit Scope(Span span);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // Writes the spans of all threads to the enabled path followed by suffix. Must not run
+    // while other threads are still recording. Returns false if the file could not be written.
+    bool write_file(const std::string &suffix = "");
+}
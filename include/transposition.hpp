@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Zobrist keys: the hash of a board is the XOR of keys[cell][symbol index] over its
+ * assigned cells, so assigning or unassigning one cell updates it with a single XOR.
+ * Generated at compile time with splitmix64, so every build hashes boards the same way.
+ */
+namespace zobrist
+{
+    struct Keys
+    {
+        uint64_t keys[81][9];
+    };
+
+    constexpr Keys make_keys()
+    {
+        Keys k = {};
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int cell = 0; cell < 81; cell++)
+        {
+            for (int s = 0; s < 9; s++)
+            {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                k.keys[cell][s] = z ^ (z >> 31);
+            }
+        }
+        return k;
+    }
+
+    inline constexpr Keys keys = make_keys();
+}
+
+/**
+ * Fixed-size, lossy set of the hashes of boards that are known to have no solution.
+ * Whether a partially filled board can be completed only depends on the board itself,
+ * so entries stay valid from one search (and one puzzle) to the next, and the table is
+ * never cleared. Each hash has a single slot, and a newer dead board replaces the older one.
+ */
+class TranspositionTable
+{
+private:
+    // 0 marks an empty slot.
+    std::vector<uint64_t> m_slots;
+    uint64_t m_index_mask = 0;
+
+public:
+    // Allocates the largest power of two slots that fits in megabytes (none for 0),
+    // discarding all entries. Does nothing if the table already has that size.
+    void resize(long long megabytes);
+
+    // Forgets all entries.
+    void clear();
+
+    bool empty() const
+    {
+        return m_slots.empty();
+    }
+
+    bool contains(uint64_t hash) const
+    {
+        return m_slots[hash & m_index_mask] == hash;
+    }
+
+    void insert(uint64_t hash)
+    {
+        m_slots[hash & m_index_mask] = hash;
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * Outcome of checking a completed grid.
+ * malformed: not 81 characters of '1'-'9'.
+ * illegal: some row, column or box does not hold every digit once.
+ * clues_changed: the grid differs from a clue of its puzzle.
+ * missing: the clues file has more lines than the grids file.
+ */
+enum class GridCheck
+{
+    valid,
+    malformed,
+    illegal,
+    clues_changed,
+    missing
+};
+
+const char *get_grid_check_name(GridCheck check);
+
+// Checks one grid, and that it keeps the clues of its puzzle if clues is not nullptr.
+GridCheck check_grid(const char *grid, size_t length, const char *clues, size_t clues_length);
+
+/**
+ * Checks every line of grids_path, against the line with the same index of clues_path unless
+ * that is empty. Writes "line_number check" for every grid to results_path, or prints the
+ * failing ones if it is empty, followed by a summary. Returns false if a file cannot be opened.
+ */
+bool verify_file(const std::string &grids_path, const std::string &clues_path, const std::string &results_path);
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Lookup tables for the constraint zones (rows, columns and squares) of the grid,
+ * generated at compile time. Cells are indexed in row-major order, i.e.
+ * cell = row * grid_size + col, so that loops over zones and peers need no division.
+ */
+namespace zones
+{
+    const int grid_size = 9;
+    const int square_size = 3;
+    const int num_cells = grid_size * grid_size;
+
+    // zones 0-8 are rows, 9-17 are columns, 18-26 are squares.
+    const int num_zones = 3 * grid_size;
+    const int zone_size = grid_size;
+
+    // Every cell shares a zone with 8 cells in its row, 8 in its column, and 4 more in its square.
+    const int num_peers = 20;
+
+    struct Tables
+    {
+        uint8_t row[num_cells];
+        uint8_t col[num_cells];
+        uint8_t square[num_cells];
+
+        // cells[zone] are the cells of the zone, in row-major order.
+        uint8_t cells[num_zones][zone_size];
+
+        // cell_zones[cell] are the row, column and square zone of the cell.
+        uint8_t cell_zones[num_cells][3];
+
+        // peers[cell] are the cells that share a zone with the cell, each listed once,
+        // the cell itself excluded: first the row, then the column, then the rest of the square.
+        uint8_t peers[num_cells][num_peers];
+    };
+
+    constexpr Tables make_tables()
+    {
+        Tables t = {};
+        for (int cell = 0; cell < num_cells; cell++)
+        {
+            int row = cell / grid_size;
+            int col = cell % grid_size;
+            int square = (row / square_size) * square_size + col / square_size;
+            t.row[cell] = row;
+            t.col[cell] = col;
+            t.square[cell] = square;
+            t.cell_zones[cell][0] = row;
+            t.cell_zones[cell][1] = grid_size + col;
+            t.cell_zones[cell][2] = 2 * grid_size + square;
+        }
+
+        for (int i = 0; i < grid_size; i++)
+        {
+            for (int p = 0; p < zone_size; p++)
+            {
+                int square_row = (i / square_size) * square_size + p / square_size;
+                int square_col = (i % square_size) * square_size + p % square_size;
+                t.cells[i][p] = i * grid_size + p;
+                t.cells[grid_size + i][p] = p * grid_size + i;
+                t.cells[2 * grid_size + i][p] = square_row * grid_size + square_col;
+            }
+        }
+
+        for (int cell = 0; cell < num_cells; cell++)
+        {
+            int count = 0;
+            for (int other = 0; other < num_cells; other++)
+            {
+                if (other != cell && t.row[other] == t.row[cell])
+                {
+                    t.peers[cell][count++] = other;
+                }
+            }
+            for (int other = 0; other < num_cells; other++)
+            {
+                if (other != cell && t.col[other] == t.col[cell])
+                {
+                    t.peers[cell][count++] = other;
+                }
+            }
+            for (int other = 0; other < num_cells; other++)
+            {
+                if (t.square[other] == t.square[cell] && t.row[other] != t.row[cell] && t.col[other] != t.col[cell])
+                {
+                    t.peers[cell][count++] = other;
+                }
+            }
+        }
+        return t;
+    }
+
+    inline constexpr Tables tables = make_tables();
+
+    static_assert(tables.peers[0][num_peers - 1] == 20, "last peer of cell 0 is (2, 2)");
+    static_assert(tables.cells[num_zones - 1][0] == 60, "last square starts at (6, 6)");
+}
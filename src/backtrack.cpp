@@ -1,170 +1,378 @@
+#include "bitops.hpp"
 #include "puzzle.hpp"
 #include "symbol.hpp"
+#include "transposition.hpp"
+#include "zones.hpp"
 #include <assert.h>
-#include <bit>
-#include <bitset>
-#include <tuple>
-#include <vector>
+
+SolveStatus check_search_limits(const SearchLimits &limits, long long num_guesses,
+                                std::chrono::steady_clock::time_point deadline)
+{
+    if ((limits.cancel && limits.cancel->load(std::memory_order_relaxed)) ||
+        (limits.race && limits.race->load(std::memory_order_relaxed)))
+    {
+        return SolveStatus::cancelled;
+    }
+    if (limits.max_guesses && num_guesses >= limits.max_guesses)
+    {
+        return SolveStatus::timed_out;
+    }
+    if (limits.time_budget.count() && std::chrono::steady_clock::now() >= deadline)
+    {
+        return SolveStatus::timed_out;
+    }
+    return SolveStatus::solved;
+}
 
 /**
- * Solves the puzzle using backtracking.
+ * Returns timed_out or cancelled if the current solve() has to stop, solved otherwise.
  */
-bool Puzzle::backtracking()
+SolveStatus Puzzle::check_limits()
 {
-    int row;
-    int col;
-    int ox;
-    int oy;
-    int popped_i;
-    int popped_j;
-    char popped_symbol = symbol::unassigned_symbol;
-    bool failure;
-    std::vector<std::tuple<size_t, size_t, char>> stack;
+    return check_search_limits(m_limits, m_num_backtracking_guesses, m_deadline);
+}
+
+/**
+ * Solves the puzzle using backtracking. Stops early with timed_out or cancelled
+ * if the search limits are exceeded, leaving the board partially assigned.
+ */
+SolveStatus Puzzle::backtracking()
+{
+    if (!start_search())
+    {
+        return SolveStatus::impossible;
+    }
+    return continue_search(false);
+}
 
+/**
+ * Returns the i-th element (from 0) of the Luby sequence: 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ...
+ */
+long long luby(long long i)
+{
+    // find the smallest complete block (of size 2^k - 1) that contains i, then
+    // descend into the repeated sub-blocks until i is the last element of one.
+    long long size = 1;
+    long long value = 1;
+    while (size < i + 1)
+    {
+        size = 2 * size + 1;
+        value *= 2;
+    }
+    while (size - 1 != i)
+    {
+        size = (size - 1) / 2;
+        value /= 2;
+        i %= size;
+    }
+    return value;
+}
+
+/**
+ * Prepares a search from the current board: empty guess stack, fresh candidates, board hash,
+ * random state seeded from the strategy, and the first restart budget.
+ * With @arg{enumerate}, the search goes on past solutions, so it neither restarts (which would
+ * find the same solutions again) nor uses the transposition table (a subtree whose solutions
+ * were all found already is exhausted, but not dead).
+ * @returns false if an unassigned cell has no candidates. Every later dead cell is a peer of
+ * the guess that empties it, which push_guess checks, so the board is only scanned here.
+ */
+bool Puzzle::start_search(bool enumerate)
+{
+    // a previous successful search leaves its undo information behind.
+    memset(m_backtrack_candidates_removed, 0, sizeof(m_backtrack_candidates_removed));
+    m_num_guesses_on_stack = 0;
+    m_random_state = m_strategy.seed ? m_strategy.seed : 1;
+    m_num_restarts = 0;
+    m_restart_budget = enumerate ? 0 : m_strategy.restart_unit;
+    m_guesses_at_restart = m_num_backtracking_guesses;
+    m_search_uses_table = !enumerate && m_table && !m_table->empty();
     calculate_all_candidates();
+    narrow_down_candidates();
 
-    // find next unassigned cell
-find_first_unassigned_cell:;
+    const char *board = board_cells();
+    const uint16_t *candidates = candidate_cells();
+    bool dead = false;
+    m_board_hash = 0;
+    for (int cell = 0; cell < gridSize * gridSize; cell++)
+    {
+        if (board[cell] != symbol::unassigned_symbol)
+        {
+            m_board_hash ^= zobrist::keys.keys[cell][symbol::get_symbol_index(board[cell])];
+        }
+        else if (candidates[cell] == 0)
+        {
+            dead = true;
+        }
+    }
+    return !dead;
+}
+
+/**
+ * xorshift64* step.
+ */
+uint64_t Puzzle::next_random()
+{
+    m_random_state ^= m_random_state >> 12;
+    m_random_state ^= m_random_state << 25;
+    m_random_state ^= m_random_state >> 27;
+    return m_random_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Undoes every guess, and sets the budget of the next run of the search.
+ */
+void Puzzle::restart_search()
+{
+    while (m_num_guesses_on_stack)
+    {
+        pop_guess();
+    }
+    m_num_restarts++;
+    m_restart_budget = m_strategy.restart_unit * luby(m_num_restarts);
+    m_guesses_at_restart = m_num_backtracking_guesses;
+}
+
+/**
+ * Picks the next symbol to try for the cell, among its untried candidates (non-empty).
+ */
+BITOPS_CLONES char Puzzle::choose_symbol(uint8_t cell, uint16_t untried)
+{
+    switch (m_strategy.value_order)
+    {
+    case ValueOrder::descending:
+        break;
+
+    case ValueOrder::random:
+        return symbol::first_symbol + bitops::select_bit(untried, next_random() % bitops::popcount(untried));
 
-    for (row = 0; row < gridSize; row++)
+    case ValueOrder::least_constraining:
     {
-        for (col = 0; col < gridSize; col++)
+        const char *board = board_cells();
+        const uint16_t *candidates = candidate_cells();
+        int best_index = -1;
+        int best_count = zones::num_peers + 1;
+        int num_ties = 0;
+        for (uint16_t remaining = untried; remaining; remaining = bitops::clear_lowest_bit(remaining))
         {
-            if (m_board[row][col] == symbol::unassigned_symbol)
+            int index = bitops::lowest_bit(remaining);
+            uint16_t symbol_mask = 1 << index;
+            int count = 0;
+            for (uint8_t peer : zones::tables.peers[cell])
             {
-                goto found_first_unassigned_cell;
+                count += board[peer] == symbol::unassigned_symbol && (candidates[peer] & symbol_mask);
+            }
+            // ties are broken uniformly at random, by keeping the k-th tie with probability 1/k.
+            if (count < best_count)
+            {
+                best_index = index;
+                best_count = count;
+                num_ties = 1;
+            }
+            else if (count == best_count && next_random() % ++num_ties == 0)
+            {
+                best_index = index;
             }
         }
+        return symbol::first_symbol + best_index;
+    }
     }
-    // If no unassigned cells are found, means that the puzzle is solved.
-    return true;
-found_first_unassigned_cell:;
+    return symbol::get_first_symbol_from_mask(untried);
+}
 
-    // if we just failed, then we popped a cell and unassigned it.
-    // that cell should always be the first unassigned cell.
-    if (failure)
+/**
+ * Returns the unassigned cell with the fewest candidates, the first one of them in row-major
+ * order, or gridSize * gridSize if every cell is assigned.
+ */
+BITOPS_CLONES int Puzzle::find_fewest_candidates_cell()
+{
+    const char *board = board_cells();
+    const uint16_t *candidates = candidate_cells();
+    int best_cell = gridSize * gridSize;
+    int best_count = numSymbols + 1;
+    for (int cell = 0; cell < gridSize * gridSize; cell++)
     {
-        assert(popped_i == row && popped_j == col);
+        if (board[cell] != symbol::unassigned_symbol)
+        {
+            continue;
+        }
+        int count = bitops::popcount(candidates[cell]);
+        if (count < best_count)
+        {
+            best_cell = cell;
+            best_count = count;
+            // no cell can do better than a forced (or dead) one.
+            if (count <= 1)
+            {
+                break;
+            }
+        }
     }
+    return best_cell;
+}
 
-    char symbol = symbol::get_next_symbol_from_mask(m_candidates[row][col], popped_symbol);
-    // char symbol = get_first_symbol_from_mask(m_candidates[row][col]);
+/**
+ * Assigns symbol to the unassigned cell, and removes it from the candidates of
+ * the unassigned peers, remembering which ones so that pop_guess can undo it.
+ * @returns false if that leaves some unassigned peer without candidates.
+ */
+bool Puzzle::push_guess(uint8_t cell, char symbol, uint16_t untried)
+{
+    char *board = board_cells();
+    uint16_t *candidates = candidate_cells();
     uint16_t symbol_mask = symbol::get_symbol_mask(symbol);
+    uint32_t removed = 0;
+    bool failure = false;
 
-    if (m_candidates[row][col] == 0 || symbol == symbol::unassigned_symbol)
-    {
-        goto failure_label;
-    }
-
-    m_board[row][col] = symbol;
+    board[cell] = symbol;
+    m_board_hash ^= zobrist::keys.keys[cell][symbol::get_symbol_index(symbol)];
     m_num_backtracking_guesses++;
-
-    stack.push_back(std::tuple(row, col, symbol));
-    failure = false;
-    popped_symbol = symbol::unassigned_symbol;
+    m_guess_stack[m_num_guesses_on_stack++] = {cell, symbol, untried};
 
     // - update backtracking candidates with info that we are removing this candidate
     // - remove the just-assigned symbol from candidates of unassigned neighbors
     // - right after removing them, perform the check to make sure there are still candidates
-
-    // row
-    for (int j = 0; j < gridSize; j++)
+    for (int k = 0; k < zones::num_peers; k++)
     {
-        if (m_board[row][j] == symbol::unassigned_symbol && (m_candidates[row][j] & symbol_mask))
+        uint8_t peer = zones::tables.peers[cell][k];
+        if (board[peer] == symbol::unassigned_symbol && (candidates[peer] & symbol_mask))
         {
-            m_backtrack_candidates_removed[row][col].insert((row * gridSize) + j);
+            removed |= 1U << k;
+            candidates[peer] &= ~symbol_mask;
 
-            m_candidates[row][j] &= ~symbol_mask;
-
-            if (m_candidates[row][j] == 0)
+            if (candidates[peer] == 0)
             {
                 failure = true;
             }
         }
     }
-    // col
-    for (int i = 0; i < gridSize; i++)
+    reinterpret_cast<uint32_t *>(m_backtrack_candidates_removed)[cell] = removed;
+    return !failure;
+}
+
+/**
+ * Undoes the last guess, restoring the candidates it removed. @returns the guess.
+ */
+Puzzle::Guess Puzzle::pop_guess()
+{
+    assert(m_num_guesses_on_stack > 0);
+    Guess guess = m_guess_stack[--m_num_guesses_on_stack];
+    uint16_t *candidates = candidate_cells();
+    uint32_t *candidates_removed = reinterpret_cast<uint32_t *>(m_backtrack_candidates_removed);
+    uint16_t symbol_mask = symbol::get_symbol_mask(guess.symbol);
+
+    assert(board_cells()[guess.cell] == guess.symbol);
+    board_cells()[guess.cell] = symbol::unassigned_symbol;
+    m_board_hash ^= zobrist::keys.keys[guess.cell][symbol::get_symbol_index(guess.symbol)];
+
+    const uint8_t *peers = zones::tables.peers[guess.cell];
+    for (uint32_t removed = candidates_removed[guess.cell]; removed; removed &= removed - 1)
     {
-        if (m_board[i][col] == symbol::unassigned_symbol && (m_candidates[i][col] & symbol_mask))
-        {
-            m_backtrack_candidates_removed[row][col].insert((i * gridSize) + col);
-            m_candidates[i][col] &= ~symbol_mask;
+        candidates[peers[__builtin_ctz(removed)]] |= symbol_mask;
+    }
+    candidates_removed[guess.cell] = 0;
+    return guess;
+}
 
-            if (m_candidates[i][col] == 0)
+/**
+ * Runs the search until the board is complete (solved), the search space is exhausted
+ * (impossible), or the search limits run out. Guesses are made in the cell the strategy's
+ * branching picks, trying its candidates in the strategy's value order.
+ * With @arg{resume}, the current complete board is rejected, and the search continues
+ * with the next solution.
+ */
+SolveStatus Puzzle::continue_search(bool resume)
+{
+    const char *board = board_cells();
+    const uint16_t *candidates = candidate_cells();
+
+    // after a failure, the last guess is undone and the same cell is retried
+    // with the candidates that have not been tried yet.
+    bool failure = resume;
+    bool retry = false;
+    uint16_t untried = 0;
+    int cell = 0;
+
+    while (true)
+    {
+        if (failure)
+        {
+            if (!m_num_guesses_on_stack)
             {
-                failure = true;
+                return SolveStatus::impossible;
             }
+            Guess guess = pop_guess();
+            cell = guess.cell;
+            untried = guess.untried;
+            retry = true;
+            failure = false;
         }
-    }
 
-    // square
-    ox = (row / squareSize) * squareSize;
-    oy = (col / squareSize) * squareSize;
-    for (int i = ox; i < ox + squareSize; i++)
-    {
-        for (int j = oy; j < oy + squareSize; j++)
+        // find next unassigned cell. a popped cell is retried. in row-major order, everything
+        // before a popped cell is assigned.
+        if (m_strategy.branching == Branching::fewest)
         {
-            if (m_board[i][j] == symbol::unassigned_symbol && (m_candidates[i][j] & symbol_mask))
+            if (!retry)
             {
-                m_backtrack_candidates_removed[row][col].insert((i * gridSize) + j);
-                m_candidates[i][j] &= ~symbol_mask;
-
-                if (m_candidates[i][j] == 0)
-                {
-                    failure = true;
-                }
+                cell = find_fewest_candidates_cell();
             }
         }
-    }
-
-    // debugging sanity check for failure
-    if (!failure)
-    {
-        for (int i = 0; i < gridSize; i++)
+        else
         {
-            for (int j = 0; j < gridSize; j++)
+            while (cell < gridSize * gridSize && board[cell] != symbol::unassigned_symbol)
             {
-                if (m_board[i][j] == symbol::unassigned_symbol && m_candidates[i][j] == 0)
-                {
-                    failure = true;
-                }
+                cell++;
             }
         }
-    }
-
-    if (failure)
-    {
-    failure_label:;
-        if (!stack.size())
+        // If no unassigned cells are found, means that the puzzle is solved.
+        if (cell == gridSize * gridSize)
         {
-            return false;
+            return SolveStatus::solved;
         }
-        auto tup = stack.back();
 
-        stack.pop_back();
-        popped_i = std::get<0>(tup);
-        popped_j = std::get<1>(tup);
-        popped_symbol = std::get<2>(tup);
-        uint16_t symbol_mask = symbol::get_symbol_mask(popped_symbol);
+        if (!retry)
+        {
+            untried = candidates[cell];
+        }
+        if (untried == 0)
+        {
+            // every candidate of the cell was refuted, so the board is dead.
+            if (retry && m_search_uses_table)
+            {
+                m_table->insert(m_board_hash);
+            }
+            failure = true;
+            retry = false;
+            continue;
+        }
+        retry = false;
 
-        assert(popped_symbol != symbol::unassigned_symbol);
-        assert(m_board[popped_i][popped_j] == popped_symbol);
-        m_board[popped_i][popped_j] = symbol::unassigned_symbol;
+        char symbol = choose_symbol(cell, untried);
+        failure = !push_guess(cell, symbol, untried & ~symbol::get_symbol_mask(symbol));
 
-        for (auto index : m_backtrack_candidates_removed[popped_i][popped_j])
+        // skip boards that an earlier search (or run of this one) already refuted.
+        if (!failure && m_search_uses_table)
         {
-            int row = index / gridSize;
-            int col = index % gridSize;
+            failure = m_table->contains(m_board_hash);
+            (failure ? m_num_table_hits : m_num_table_misses)++;
+        }
 
-            // only restore the candidates if it is not the failed cell.
-            // The failed cell needs to keep that candidate removed, so
-            // we dont try it again, since it didnt work out.
-            if (row != popped_i || col != popped_j)
+        // only look at the clock every so often, the guess counter is checked along with it.
+        if ((m_num_backtracking_guesses & (SearchLimits::check_interval - 1)) == 0 ||
+            m_num_backtracking_guesses == m_limits.max_guesses)
+        {
+            SolveStatus status = check_limits();
+            if (status != SolveStatus::solved)
             {
-                m_candidates[row][col] |= symbol_mask;
+                return status;
             }
         }
-        m_backtrack_candidates_removed[popped_i][popped_j].clear();
+
+        if (m_restart_budget && m_num_backtracking_guesses - m_guesses_at_restart >= m_restart_budget)
+        {
+            restart_search();
+            failure = false;
+            cell = 0;
+        }
     }
-    goto find_first_unassigned_cell;
-}
\ No newline at end of file
+}
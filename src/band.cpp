@@ -0,0 +1,457 @@
+#include "band.hpp"
+#include "symbol.hpp"
+
+namespace
+{
+    const uint32_t all_cells = (1U << BandSolver::band_cells) - 1;
+
+    // Masks within a band, of its k-th row, its k-th box, and of column c.
+    constexpr uint32_t row_mask(int k)
+    {
+        return 0x1FFU << (9 * k);
+    }
+
+    constexpr uint32_t box_mask(int k)
+    {
+        return 0x1C0E07U << (3 * k);
+    }
+
+    constexpr uint32_t col_mask(int c)
+    {
+        return 0x40201U << c;
+    }
+
+    bool has_single_bit(uint32_t mask)
+    {
+        return mask && !(mask & (mask - 1));
+    }
+
+    struct BandTables
+    {
+        // peers[cell][band] are the cells of band that share a zone with cell, cell excluded.
+        uint32_t peers[81][BandSolver::num_bands];
+    };
+
+    constexpr BandTables make_band_tables()
+    {
+        BandTables t = {};
+        for (int cell = 0; cell < 81; cell++)
+        {
+            int row = cell / 9;
+            int col = cell % 9;
+            for (int band = 0; band < BandSolver::num_bands; band++)
+            {
+                uint32_t mask = col_mask(col);
+                if (band == row / 3)
+                {
+                    mask |= row_mask(row % 3) | box_mask(col / 3);
+                    mask &= ~(1U << (cell % BandSolver::band_cells));
+                }
+                t.peers[cell][band] = mask;
+            }
+        }
+        return t;
+    }
+
+    constexpr BandTables band_tables = make_band_tables();
+
+    static_assert(band_tables.peers[0][0] == ((0x1FFU | 0x40201U | 0x1C0E07U) & ~1U), "peers of cell 0 in its band");
+    static_assert(band_tables.peers[0][2] == 0x40201U, "peers of cell 0 in the last band are its column");
+}
+
+/**
+ * Places digit in cell: the cell loses every other candidate, and the peers of the cell lose digit.
+ */
+void BandSolver::assign(State &state, int digit, int cell)
+{
+    int band = cell / band_cells;
+    uint32_t bit = 1U << (cell % band_cells);
+    for (auto &digit_candidates : state.candidates)
+    {
+        digit_candidates[band] &= ~bit;
+    }
+    for (int b = 0; b < num_bands; b++)
+    {
+        state.candidates[digit][b] &= ~band_tables.peers[cell][b];
+    }
+    state.candidates[digit][band] |= bit;
+    state.unsolved[band] &= ~bit;
+}
+
+/**
+ * Assigns naked singles (cells with one candidate) and hidden singles (the only cell of a zone
+ * that can hold a digit). Sets progress if anything was assigned.
+ * @returns false if some cell has no candidates, or some zone has no place for a digit.
+ */
+bool BandSolver::apply_singles(State &state, bool &progress)
+{
+    // naked singles: count candidates per cell up to 2, with one bit-sliced counter per band.
+    for (int band = 0; band < num_bands; band++)
+    {
+        uint32_t at_least_one = 0;
+        uint32_t at_least_two = 0;
+        for (auto &digit_candidates : state.candidates)
+        {
+            at_least_two |= at_least_one & digit_candidates[band];
+            at_least_one |= digit_candidates[band];
+        }
+        if (at_least_one != all_cells)
+        {
+            return false;
+        }
+        for (uint32_t singles = at_least_one & ~at_least_two & state.unsolved[band]; singles; singles &= singles - 1)
+        {
+            int index = __builtin_ctz(singles);
+            int digit = 0;
+            while (digit < 9 && !(state.candidates[digit][band] & (1U << index)))
+            {
+                digit++;
+            }
+            // an earlier single in this loop took the last candidate.
+            if (digit == 9)
+            {
+                return false;
+            }
+            assign(state, digit, band * band_cells + index);
+            progress = true;
+        }
+    }
+
+    for (int digit = 0; digit < 9; digit++)
+    {
+        uint32_t *candidates = state.candidates[digit];
+
+        // rows and boxes lie within one band.
+        for (int band = 0; band < num_bands; band++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                for (uint32_t zone : {row_mask(k), box_mask(k)})
+                {
+                    uint32_t cells = candidates[band] & zone;
+                    if (!cells)
+                    {
+                        return false;
+                    }
+                    if (has_single_bit(cells) && (cells & state.unsolved[band]))
+                    {
+                        assign(state, digit, band * band_cells + __builtin_ctz(cells));
+                        progress = true;
+                    }
+                }
+            }
+        }
+
+        // columns span all bands: count the 9 row slices per column, up to 2.
+        uint32_t at_least_one = 0;
+        uint32_t at_least_two = 0;
+        for (int band = 0; band < num_bands; band++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t slice = (candidates[band] >> (9 * k)) & 0x1FF;
+                at_least_two |= at_least_one & slice;
+                at_least_one |= slice;
+            }
+        }
+        if (at_least_one != 0x1FF)
+        {
+            return false;
+        }
+        for (uint32_t singles = at_least_one & ~at_least_two; singles; singles &= singles - 1)
+        {
+            int col = __builtin_ctz(singles);
+            for (int band = 0; band < num_bands; band++)
+            {
+                uint32_t cells = candidates[band] & col_mask(col) & state.unsolved[band];
+                if (cells)
+                {
+                    assign(state, digit, band * band_cells + __builtin_ctz(cells));
+                    progress = true;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Box-line interactions. Within a band, a digit that a box only has in one row cannot be
+ * elsewhere in that row (pointing), and a digit that a row only has in one box cannot be
+ * elsewhere in that box (claiming). The same holds for the columns of a stack of boxes.
+ * Sets progress if any candidate was removed.
+ * @returns false if that leaves a zone without a place for a digit.
+ */
+bool BandSolver::apply_box_line(State &state, bool &progress)
+{
+    for (int digit = 0; digit < 9; digit++)
+    {
+        uint32_t *candidates = state.candidates[digit];
+        uint32_t columns[num_bands];
+
+        for (int band = 0; band < num_bands; band++)
+        {
+            uint32_t cells = candidates[band];
+
+            // segments[3 * row + box] is set if the 3 cells of row within box hold candidates.
+            uint32_t occupied = cells | (cells >> 1) | (cells >> 2);
+            uint32_t segments = 0;
+            for (int i = 0; i < 9; i++)
+            {
+                segments |= ((occupied >> (9 * (i / 3) + 3 * (i % 3))) & 1) << i;
+            }
+            uint32_t remove = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t boxes_of_row = (segments >> (3 * k)) & 7;
+                if (has_single_bit(boxes_of_row))
+                {
+                    remove |= box_mask(__builtin_ctz(boxes_of_row)) & ~row_mask(k);
+                }
+                uint32_t rows_of_box = ((segments >> k) & 1) | ((segments >> (k + 2)) & 2) | ((segments >> (k + 4)) & 4);
+                if (has_single_bit(rows_of_box))
+                {
+                    remove |= row_mask(__builtin_ctz(rows_of_box)) & ~box_mask(k);
+                }
+            }
+            if (cells & remove)
+            {
+                candidates[band] &= ~remove;
+                progress = true;
+            }
+            columns[band] = (candidates[band] | (candidates[band] >> 9) | (candidates[band] >> 18)) & 0x1FF;
+        }
+
+        for (int band = 0; band < num_bands; band++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                // pointing: the box only has the digit in one column.
+                uint32_t columns_of_box = (columns[band] >> (3 * k)) & 7;
+                if (has_single_bit(columns_of_box))
+                {
+                    uint32_t column = col_mask(3 * k + __builtin_ctz(columns_of_box));
+                    for (int other = 0; other < num_bands; other++)
+                    {
+                        if (other != band && (candidates[other] & column))
+                        {
+                            candidates[other] &= ~column;
+                            progress = true;
+                        }
+                    }
+                }
+            }
+        }
+        for (int col = 0; col < 9; col++)
+        {
+            // claiming: the column only has the digit in one band.
+            uint32_t bands_of_column = ((columns[0] >> col) & 1) | (((columns[1] >> col) & 1) << 1) |
+                                       (((columns[2] >> col) & 1) << 2);
+            if (!bands_of_column)
+            {
+                return false;
+            }
+            if (has_single_bit(bands_of_column))
+            {
+                int band = __builtin_ctz(bands_of_column);
+                uint32_t remove = box_mask(col / 3) & ~col_mask(col);
+                if (candidates[band] & remove)
+                {
+                    candidates[band] &= ~remove;
+                    progress = true;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Applies singles until there are none left, then box-line interactions, as long as
+ * either makes progress. @returns false on a contradiction.
+ */
+bool BandSolver::propagate(State &state)
+{
+    while (true)
+    {
+        bool progress = false;
+        if (!apply_singles(state, progress))
+        {
+            return false;
+        }
+        if (progress)
+        {
+            continue;
+        }
+        if (!apply_box_line(state, progress))
+        {
+            return false;
+        }
+        if (!progress)
+        {
+            return true;
+        }
+    }
+}
+
+void BandSolver::load(const char *board)
+{
+    State &state = m_stack[0];
+    for (auto &digit_candidates : state.candidates)
+    {
+        for (uint32_t &band_candidates : digit_candidates)
+        {
+            band_candidates = all_cells;
+        }
+    }
+    for (uint32_t &band_unsolved : state.unsolved)
+    {
+        band_unsolved = all_cells;
+    }
+    for (int cell = 0; cell < 81; cell++)
+    {
+        if (board[cell] != symbol::unassigned_symbol)
+        {
+            assign(state, symbol::get_symbol_index(board[cell]), cell);
+        }
+    }
+    m_depth = 0;
+    m_num_guesses = 0;
+    m_num_logic_assignments = 0;
+}
+
+/**
+ * Guesses every candidate of the unsolved cell with the fewest candidates in turn, each on a
+ * copy of the current state, and recurses. Leaves m_depth at the solved state when solved.
+ */
+SolveStatus BandSolver::search()
+{
+    const State &state = m_stack[m_depth];
+
+    // cells with exactly two candidates are the best guesses, and common.
+    int best_cell = -1;
+    int best_count = 10;
+    for (int band = 0; band < num_bands && best_count > 2; band++)
+    {
+        uint32_t at_least_one = 0;
+        uint32_t at_least_two = 0;
+        uint32_t at_least_three = 0;
+        for (auto &digit_candidates : state.candidates)
+        {
+            at_least_three |= at_least_two & digit_candidates[band];
+            at_least_two |= at_least_one & digit_candidates[band];
+            at_least_one |= digit_candidates[band];
+        }
+        uint32_t pairs = at_least_two & ~at_least_three & state.unsolved[band];
+        if (pairs)
+        {
+            best_cell = band * band_cells + __builtin_ctz(pairs);
+            best_count = 2;
+        }
+    }
+    for (int band = 0; band < num_bands && best_count > 2; band++)
+    {
+        for (uint32_t cells = state.unsolved[band]; cells; cells &= cells - 1)
+        {
+            int index = __builtin_ctz(cells);
+            int count = 0;
+            for (auto &digit_candidates : state.candidates)
+            {
+                count += (digit_candidates[band] >> index) & 1;
+            }
+            if (count < best_count)
+            {
+                best_cell = band * band_cells + index;
+                best_count = count;
+            }
+        }
+    }
+    if (best_cell < 0)
+    {
+        return SolveStatus::solved;
+    }
+
+    int band = best_cell / band_cells;
+    uint32_t bit = 1U << (best_cell % band_cells);
+    for (int digit = 0; digit < 9; digit++)
+    {
+        if (!(m_stack[m_depth].candidates[digit][band] & bit))
+        {
+            continue;
+        }
+        m_stack[m_depth + 1] = m_stack[m_depth];
+        m_depth++;
+        m_num_guesses++;
+        if ((m_num_guesses & (SearchLimits::check_interval - 1)) == 0 || m_num_guesses == m_limits.max_guesses)
+        {
+            SolveStatus status = check_search_limits(m_limits, m_num_guesses, m_deadline);
+            if (status != SolveStatus::solved)
+            {
+                return status;
+            }
+        }
+
+        assign(m_stack[m_depth], digit, best_cell);
+        if (propagate(m_stack[m_depth]))
+        {
+            SolveStatus status = search();
+            if (status != SolveStatus::impossible)
+            {
+                return status;
+            }
+        }
+        m_depth--;
+    }
+    return SolveStatus::impossible;
+}
+
+SolveStatus BandSolver::solve(const SearchLimits &limits, std::chrono::steady_clock::time_point deadline)
+{
+    m_limits = limits;
+    m_deadline = deadline;
+
+    auto count_solved = [](const State &state) {
+        return num_bands * band_cells - __builtin_popcount(state.unsolved[0]) -
+               __builtin_popcount(state.unsolved[1]) - __builtin_popcount(state.unsolved[2]);
+    };
+    int num_clues = count_solved(m_stack[0]);
+    if (!propagate(m_stack[0]))
+    {
+        return SolveStatus::impossible;
+    }
+    m_num_logic_assignments = count_solved(m_stack[0]) - num_clues;
+    return search();
+}
+
+void BandSolver::get_board(char *board) const
+{
+    const State &state = m_stack[m_depth];
+    for (int cell = 0; cell < 81; cell++)
+    {
+        int band = cell / band_cells;
+        uint32_t bit = 1U << (cell % band_cells);
+        board[cell] = symbol::unassigned_symbol;
+        for (int digit = 0; digit < 9 && !(state.unsolved[band] & bit); digit++)
+        {
+            if (state.candidates[digit][band] & bit)
+            {
+                board[cell] = symbol::first_symbol + digit;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Solves the puzzle with a BandSolver, and takes over its board and counts.
+ */
+SolveStatus Puzzle::solve_with_bands()
+{
+    thread_local BandSolver solver;
+    solver.load(board_cells());
+    SolveStatus status = solver.solve(m_limits, m_deadline);
+    solver.get_board(board_cells());
+    m_num_logic_assignments = solver.get_num_logic_assignments();
+    m_num_backtracking_guesses = solver.get_num_guesses();
+    return status;
+}
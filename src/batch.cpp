@@ -0,0 +1,543 @@
+#include "batch.hpp"
+#include "colors.hpp"
+#include "perf.hpp"
+#include "process_args.hpp"
+#include "rule_stats.hpp"
+#include "store.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+InputFile::~InputFile()
+{
+    if (m_data)
+    {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+}
+
+bool InputFile::open(const std::string &filepath)
+{
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    m_size = st.st_size;
+    if (m_size > 0)
+    {
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(data);
+    }
+    close(fd);
+    return true;
+}
+
+LineRange get_shard_range(const InputFile &input, int shard, int shard_count)
+{
+    const char *data = input.data();
+    size_t size = input.size();
+
+    // the first line that starts at or after offset.
+    auto line_start_at_or_after = [&](size_t offset) {
+        if (offset == 0 || offset >= size)
+        {
+            return std::min(offset, size);
+        }
+        const void *newline = memchr(data + offset - 1, '\n', size - offset + 1);
+        return newline ? size_t(static_cast<const char *>(newline) - data) + 1 : size;
+    };
+
+    LineRange range;
+    range.begin = line_start_at_or_after(size * shard / shard_count);
+    range.end = line_start_at_or_after(size * (shard + 1) / shard_count);
+    range.first_line_number = 1 + std::count(data, data + range.begin, '\n');
+    return range;
+}
+
+/**
+ * Opens path for writing after its first `size` bytes, dropping the rest, and creates it if needed.
+ */
+bool open_results(const std::string &path, size_t size, std::ofstream &out)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    bool ok = fd >= 0 && ftruncate(fd, size) == 0;
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (ok)
+    {
+        out.open(path, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(size);
+    }
+    return ok && out.is_open();
+}
+
+bool process_line_range(const InputFile &input, const LineRange &range, const std::string &results_path,
+                        const SearchLimits &limits, const SearchStrategy &strategy,
+                        int &count_solved, int &total, LatencyStats &stats, Journal &journal)
+{
+    Progress progress;
+    progress.input_size = input.size();
+    progress.range_begin = range.begin;
+    progress.range_end = range.end;
+    progress.input_offset = range.begin;
+    progress.line_number = range.first_line_number;
+    if (!journal.load(progress))
+    {
+        return false;
+    }
+    std::ofstream results;
+    if (!open_results(results_path, progress.results_size, results))
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << results_path << Color::endl;
+        return false;
+    }
+    count_solved += progress.count_solved;
+    total += progress.total;
+
+    // checkpoints the progress up to the line at offset, with everything before it written out.
+    bool journal_ok = true;
+    auto checkpoint = [&](size_t offset, size_t line_number) {
+        perf::Scope scope(perf::Phase::io);
+        trace::Scope span(trace::Span::write);
+        results.flush();
+        progress.input_offset = std::min(offset, range.end);
+        progress.line_number = line_number;
+        progress.total = total;
+        progress.count_solved = count_solved;
+        progress.results_size = results.tellp();
+        journal_ok = journal.checkpoint(progress) && journal_ok;
+    };
+
+    const char *data = input.data();
+    size_t line_number = progress.line_number;
+    bool stopped = false;
+    for (size_t begin = progress.input_offset; begin < range.end && !cancel_requested; line_number++)
+    {
+        const char *newline = static_cast<const char *>(memchr(data + begin, '\n', range.end - begin));
+        size_t end = newline ? newline - data : range.end;
+        size_t length = end - begin;
+        if (length > 0 && data[end - 1] == '\r')
+        {
+            length--;
+        }
+        if (length > 0)
+        {
+            trace::set_puzzle(line_number);
+            SolveStatus status = solve_puzzle_string(data + begin, length, limits, strategy);
+            if (journal.is_enabled() && (status == SolveStatus::cancelled || journal.is_due()))
+            {
+                // the checkpoint ends before this puzzle, so that a cancelled one is solved again.
+                checkpoint(begin, line_number);
+                stopped = status == SolveStatus::cancelled;
+            }
+            count_solved += status == SolveStatus::solved;
+            total++;
+            stats.record(data + begin, status, get_solver_context().puzzle);
+            perf::Scope scope(perf::Phase::io);
+            trace::Scope span(trace::Span::write);
+            results << line_number << ' ' << get_status_name(status) << ' '
+                    << get_solver_context().puzzle.get_puzzle_string_view() << '\n';
+        }
+        begin = end + 1;
+        if (journal.is_enabled() && !stopped && (begin >= range.end || cancel_requested))
+        {
+            checkpoint(begin, line_number + 1);
+        }
+    }
+    return bool(results.flush()) && journal_ok;
+}
+
+char record::get_status_byte(SolveStatus status)
+{
+    switch (status)
+    {
+    case SolveStatus::solved:
+        return solved;
+    case SolveStatus::impossible:
+        return impossible;
+    case SolveStatus::timed_out:
+        return timed_out;
+    case SolveStatus::cancelled:
+        return cancelled;
+    case SolveStatus::invalid:
+        return invalid;
+    case SolveStatus::illegal:
+        return illegal;
+    }
+    return not_written;
+}
+
+std::vector<PuzzleLine> index_puzzle_lines(const InputFile &input, const LineRange &range)
+{
+    std::vector<PuzzleLine> lines;
+    const char *data = input.data();
+    for (size_t begin = range.begin; begin < range.end;)
+    {
+        const char *newline = static_cast<const char *>(memchr(data + begin, '\n', range.end - begin));
+        size_t end = newline ? newline - data : range.end;
+        size_t length = end - begin;
+        if (length > 0 && data[end - 1] == '\r')
+        {
+            length--;
+        }
+        if (length > 0)
+        {
+            lines.push_back({begin, length});
+        }
+        begin = end + 1;
+    }
+    return lines;
+}
+
+bool process_file_records(const std::string &filepath, const std::string &records_path, int threads,
+                          int shard, int shard_count, const SearchLimits &limits,
+                          const SearchStrategy &strategy, Journal journal)
+{
+    InputFile input;
+    if (!input.open(filepath))
+    {
+        std::cout << Color::red << "Could not open file: " << Color::purple << filepath << Color::endl;
+        return false;
+    }
+    LineRange range = get_shard_range(input, shard, shard_count);
+    Progress progress;
+    progress.input_size = input.size();
+    progress.range_begin = range.begin;
+    progress.range_end = range.end;
+    progress.input_offset = range.begin;
+    progress.line_number = range.first_line_number;
+    if (!journal.load(progress))
+    {
+        return false;
+    }
+
+    // the records before the checkpoint are finished, so only the rest of the range is indexed.
+    size_t first_index = progress.total;
+    long long resumed_solved = progress.count_solved;
+    std::vector<PuzzleLine> lines;
+    {
+        // the first pass over the input pages it in.
+        perf::Scope scope(perf::Phase::io);
+        trace::Scope span(trace::Span::read);
+        lines = index_puzzle_lines(input, {progress.input_offset, range.end, progress.line_number});
+    }
+    size_t record_count = first_index + lines.size();
+    size_t output_size = record_count * record::record_size;
+
+    int fd = ::open(records_path.c_str(), O_RDWR | O_CREAT | (journal.is_resumed() ? 0 : O_TRUNC), 0644);
+    if (fd < 0 || ftruncate(fd, output_size) != 0)
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << records_path << Color::endl;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    char *output = nullptr;
+    if (output_size > 0)
+    {
+        void *mapping = mmap(nullptr, output_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            std::cout << Color::red << "Could not map file: " << Color::purple << records_path << Color::endl;
+            close(fd);
+            return false;
+        }
+        output = static_cast<char *>(mapping);
+    }
+    close(fd);
+
+    // a status byte is stored after its board, so a record with a status is complete.
+    auto get_status = [&](size_t index) {
+        return std::atomic_ref<char>(output[index * record::record_size + record::board_size])
+            .load(std::memory_order_acquire);
+    };
+    auto is_finished = [](char status) {
+        return status != record::not_written && status != record::cancelled;
+    };
+
+    // checkpoints the finished records that precede the first unfinished one.
+    std::mutex journal_mutex;
+    bool journal_ok = true;
+    auto checkpoint = [&]() {
+        perf::Scope scope(perf::Phase::io);
+        trace::Scope span(trace::Span::write);
+        size_t index = progress.total;
+        for (char status; index < record_count && is_finished(status = get_status(index)); index++)
+        {
+            progress.count_solved += status == record::solved;
+        }
+        size_t offset = index < record_count ? lines[index - first_index].offset : range.end;
+        progress.line_number += std::count(input.data() + progress.input_offset, input.data() + offset, '\n');
+        progress.input_offset = offset;
+        progress.total = index;
+        journal_ok = journal.checkpoint(progress) && journal_ok;
+    };
+
+    // workers claim chunks of puzzles, so that the shared counter is rarely touched.
+    const size_t chunk_size = 64;
+    std::atomic<size_t> next_index(first_index);
+    std::atomic<int> count_solved(0);
+    LatencyStats stats;
+    std::mutex stats_mutex;
+    auto worker = [&]() {
+        int solved = 0;
+        LatencyStats worker_stats;
+        while (!cancel_requested)
+        {
+            size_t begin = next_index.fetch_add(chunk_size, std::memory_order_relaxed);
+            if (begin >= record_count)
+            {
+                break;
+            }
+            size_t end = std::min(begin + chunk_size, record_count);
+            for (size_t index = begin; index < end && !cancel_requested; index++)
+            {
+                if (journal.is_resumed() && is_finished(get_status(index)))
+                {
+                    // finished after the checkpoint, before the run was interrupted.
+                    solved += get_status(index) == record::solved;
+                    continue;
+                }
+                const PuzzleLine &line = lines[index - first_index];
+                trace::set_puzzle(index);
+                SolveStatus status = solve_puzzle_string(input.data() + line.offset, line.length, limits, strategy);
+                solved += status == SolveStatus::solved;
+                worker_stats.record(input.data() + line.offset, status, get_solver_context().puzzle);
+                trace::Scope span(trace::Span::write);
+                char *out = output + index * record::record_size;
+                memcpy(out, get_solver_context().puzzle.get_puzzle_string_view().data(), record::board_size);
+                std::atomic_ref<char>(out[record::board_size])
+                    .store(record::get_status_byte(status), std::memory_order_release);
+            }
+            if (journal.is_enabled())
+            {
+                std::unique_lock<std::mutex> lock(journal_mutex, std::try_to_lock);
+                if (lock.owns_lock() && journal.is_due())
+                {
+                    checkpoint();
+                }
+            }
+        }
+        count_solved += solved;
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.merge(worker_stats);
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+
+    if (journal.is_enabled())
+    {
+        checkpoint();
+    }
+    if (output)
+    {
+        perf::Scope scope(perf::Phase::io);
+        munmap(output, output_size);
+    }
+    print_success_statistic(resumed_solved + count_solved, record_count);
+    return stats.report(shard_count > 1 ? ".shard" + std::to_string(shard) : "") && journal_ok;
+}
+
+bool process_file_shard(const std::string &filepath, int shard, int shard_count,
+                        const std::string &results_path, const SearchLimits &limits,
+                        const SearchStrategy &strategy, Journal journal)
+{
+    InputFile input;
+    if (!input.open(filepath))
+    {
+        std::cout << Color::red << "Could not open file: " << Color::purple << filepath << Color::endl;
+        return false;
+    }
+    int count_solved = 0;
+    int total = 0;
+    LatencyStats stats;
+    LineRange range = get_shard_range(input, shard, shard_count);
+    bool ok = process_line_range(input, range, results_path, limits, strategy, count_solved, total, stats, journal);
+
+    std::cout << Color::teal << "Shard " << shard << "/" << shard_count << ": " << Color::end;
+    print_success_statistic(count_solved, total);
+    return stats.report(shard_count > 1 ? ".shard" + std::to_string(shard) : "") && ok;
+}
+
+bool process_file_forked(const std::string &filepath, int procs,
+                         const std::string &results_path, const SearchLimits &limits,
+                         const SearchStrategy &strategy, const Journal &journal)
+{
+    std::vector<std::string> shard_paths;
+    std::vector<pid_t> pids;
+    std::cout.flush();
+
+    for (int shard = 0; shard < procs; shard++)
+    {
+        shard_paths.push_back(results_path + ".shard" + std::to_string(shard));
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            bool ok = process_file_shard(filepath, shard, procs, shard_paths.back(), limits, strategy,
+                                         journal.for_shard(shard));
+            if (perf::is_enabled())
+            {
+                perf::print_report();
+            }
+            if (rule_stats::is_enabled())
+            {
+                rule_stats::print_report();
+            }
+            if (get_solution_store().is_enabled())
+            {
+                get_solution_store().print_report();
+            }
+            if (trace::is_enabled())
+            {
+                ok = trace::write_file(".shard" + std::to_string(shard)) && ok;
+            }
+            std::cout.flush();
+            _exit(ok ? 0 : 1);
+        }
+        if (pid < 0)
+        {
+            std::cout << Color::red << "Could not start process for shard " << shard << Color::endl;
+        }
+        pids.push_back(pid);
+    }
+
+    bool ok = true;
+    for (int shard = 0; shard < procs; shard++)
+    {
+        int wstatus = 0;
+        if (pids[shard] < 0 || waitpid(pids[shard], &wstatus, 0) < 0)
+        {
+            ok = false;
+            continue;
+        }
+        if (WIFSIGNALED(wstatus) || WEXITSTATUS(wstatus) != 0)
+        {
+            std::cout << Color::red << "Shard " << shard << "/" << procs << " failed";
+            if (WIFSIGNALED(wstatus))
+            {
+                std::cout << " (signal " << WTERMSIG(wstatus) << ")";
+            }
+            std::cout << ", its results may be incomplete." << Color::endl;
+            ok = false;
+        }
+    }
+
+    ok = merge_results(results_path, shard_paths) && ok;
+    if ((!ok || cancel_requested) && journal.is_enabled())
+    {
+        // --resume continues the unfinished shards from their results and journals.
+        return false;
+    }
+    for (int shard = 0; shard < procs; shard++)
+    {
+        std::remove(shard_paths[shard].c_str());
+        if (journal.is_enabled())
+        {
+            std::remove(journal.for_shard(shard).get_path().c_str());
+        }
+    }
+    return ok;
+}
+
+/**
+ * One "line_number status board" record of a result file.
+ */
+struct ResultRecord
+{
+    size_t line_number;
+    std::string status;
+    std::string board;
+};
+
+bool read_result_record(std::istream &in, ResultRecord &record)
+{
+    return bool(in >> record.line_number >> record.status >> record.board);
+}
+
+bool merge_results(const std::string &out_path, const std::vector<std::string> &inputs)
+{
+    perf::Scope scope(perf::Phase::io);
+    trace::Scope span(trace::Span::write);
+    std::vector<std::ifstream> files;
+    std::vector<ResultRecord> heads(inputs.size());
+    std::vector<bool> has_head(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        files.emplace_back(inputs[i], std::ios::binary);
+        if (!files.back().is_open())
+        {
+            std::cout << Color::red << "Could not open file: " << Color::purple << inputs[i] << Color::endl;
+        }
+        has_head[i] = read_result_record(files[i], heads[i]);
+    }
+
+    std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << out_path << Color::endl;
+        return false;
+    }
+
+    // every input is already ordered, so repeatedly take the smallest head.
+    int count_solved = 0;
+    int total = 0;
+    while (true)
+    {
+        int next = -1;
+        for (size_t i = 0; i < heads.size(); i++)
+        {
+            if (has_head[i] && (next < 0 || heads[i].line_number < heads[next].line_number))
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        const ResultRecord &record = heads[next];
+        out << record.line_number << ' ' << record.status << ' ' << record.board << '\n';
+        count_solved += record.status == get_status_name(SolveStatus::solved);
+        total++;
+        has_head[next] = read_result_record(files[next], heads[next]);
+    }
+
+    print_success_statistic(count_solved, total);
+    return bool(out.flush());
+}
@@ -0,0 +1,202 @@
+#include "bitops.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BITOPS_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    /**
+     * Portable builds, without any instruction set assumptions beyond baseline x86-64.
+     */
+    void generic_transpose_unit(const uint16_t cells[9], uint16_t positions[9])
+    {
+        for (int s = 0; s < 9; s++)
+        {
+            uint16_t position_mask = 0;
+            for (int p = 0; p < 9; p++)
+            {
+                position_mask |= ((cells[p] >> s) & 1) << p;
+            }
+            positions[s] = position_mask;
+        }
+    }
+
+    void generic_digit_planes(const char grid[81], uint32_t planes[9][3])
+    {
+        memset(planes, 0, 9 * 3 * sizeof(uint32_t));
+        for (int cell = 0; cell < 81; cell++)
+        {
+            unsigned index = grid[cell] - '1';
+            if (index < 9)
+            {
+                planes[index][cell / 27] |= 1U << (cell % 27);
+            }
+        }
+    }
+
+    const bitops::Kernels generic_kernels = {
+        "generic",
+        generic_transpose_unit,
+        generic_digit_planes,
+    };
+
+#ifdef BITOPS_X86
+#define TARGET_BMI2 __attribute__((target("bmi2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+    /**
+     * BMI2 build. The unit transposition extracts one symbol's bit from four 16-bit cells
+     * at a time with PEXT, which is only fast where PEXT is not microcoded (see has_fast_pext).
+     */
+    TARGET_BMI2 void bmi2_transpose_unit(const uint16_t cells[9], uint16_t positions[9])
+    {
+        const uint64_t lane_mask = 0x0001000100010001ULL;
+        uint64_t low;
+        uint64_t high;
+        memcpy(&low, cells, sizeof(low));
+        memcpy(&high, cells + 4, sizeof(high));
+        uint32_t last = cells[8];
+        for (int s = 0; s < 9; s++)
+        {
+            positions[s] = _pext_u64(low, lane_mask << s) |
+                           (_pext_u64(high, lane_mask << s) << 4) |
+                           (((last >> s) & 1) << 8);
+        }
+    }
+
+    const bitops::Kernels bmi2_kernels = {
+        "bmi2",
+        bmi2_transpose_unit,
+        generic_digit_planes,
+    };
+
+    /**
+     * AVX2 builds. The unit transposition shifts each symbol's bit into the sign bit of all
+     * 16-bit lanes at once, packs the lanes to bytes with signed saturation, which keeps the
+     * signs, and collects them with a byte movemask: cells 0-7 land in bits 0-7, cell 8 in bit 16.
+     */
+    TARGET_AVX2 void avx2_transpose_unit(const uint16_t cells[9], uint16_t positions[9])
+    {
+        uint16_t lanes[16] = {};
+        memcpy(lanes, cells, 9 * sizeof(uint16_t));
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lanes));
+        for (int s = 0; s < 9; s++)
+        {
+            __m256i shifted = _mm256_sll_epi16(v, _mm_cvtsi32_si128(15 - s));
+            uint32_t signs = _mm256_movemask_epi8(_mm256_packs_epi16(shifted, _mm256_setzero_si256()));
+            positions[s] = (signs & 0xFF) | ((signs >> 8) & 0x100);
+        }
+    }
+
+    /**
+     * Compares each band of 27 characters against every digit at once, and collects the
+     * matching positions with a byte movemask.
+     */
+    TARGET_AVX2 void avx2_digit_planes(const char grid[81], uint32_t planes[9][3])
+    {
+        // the last band is read 32 bytes wide, which must not run past the grid.
+        char padded[96] = {};
+        memcpy(padded, grid, 81);
+        for (int band = 0; band < 3; band++)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(padded + 27 * band));
+            for (int index = 0; index < 9; index++)
+            {
+                __m256i matches = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('1' + index));
+                planes[index][band] = uint32_t(_mm256_movemask_epi8(matches)) & 0x7FFFFFF;
+            }
+        }
+    }
+
+    const bitops::Kernels avx2_kernels = {
+        "avx2",
+        avx2_transpose_unit,
+        avx2_digit_planes,
+    };
+#endif
+
+#ifdef BITOPS_X86
+    /**
+     * AMD CPUs before Zen 3 (family 0x19) implement PEXT and PDEP in microcode, at tens of
+     * cycles per instruction, which makes the BMI2 build slower than the generic one there.
+     */
+    bool has_fast_pext()
+    {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+        {
+            return false;
+        }
+        // the vendor string is "AuthenticAMD" in ebx, edx, ecx.
+        bool amd = ebx == 0x68747541 && edx == 0x69746e65 && ecx == 0x444d4163;
+        if (!amd)
+        {
+            return true;
+        }
+        __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+        unsigned family = (eax >> 8) & 0xF;
+        if (family == 0xF)
+        {
+            family += (eax >> 20) & 0xFF;
+        }
+        return family >= 0x19;
+    }
+#endif
+
+    bool cpu_supports(const bitops::Kernels *kernels)
+    {
+#ifdef BITOPS_X86
+        __builtin_cpu_init();
+        if (kernels == &bmi2_kernels)
+        {
+            return __builtin_cpu_supports("bmi2");
+        }
+        if (kernels == &avx2_kernels)
+        {
+            return __builtin_cpu_supports("avx2");
+        }
+#endif
+        return kernels == &generic_kernels;
+    }
+
+    const bitops::Kernels *detect_kernels()
+    {
+#ifdef BITOPS_X86
+        if (cpu_supports(&avx2_kernels))
+        {
+            return &avx2_kernels;
+        }
+        if (cpu_supports(&bmi2_kernels) && has_fast_pext())
+        {
+            return &bmi2_kernels;
+        }
+#endif
+        return &generic_kernels;
+    }
+}
+
+const bitops::Kernels *bitops::active = detect_kernels();
+
+bool bitops::select(const std::string &name)
+{
+    const Kernels *all[] = {
+        &generic_kernels,
+#ifdef BITOPS_X86
+        &bmi2_kernels,
+        &avx2_kernels,
+#endif
+    };
+    for (const Kernels *kernels : all)
+    {
+        if (name == kernels->name && cpu_supports(kernels))
+        {
+            active = kernels;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,5 +1,7 @@
+#include "bitops.hpp"
 #include "puzzle.hpp"
 #include "symbol.hpp"
+#include "zones.hpp"
 
 /**
  * Iterates over the board and initializes + calculates candidates for each cell,
@@ -17,7 +19,6 @@ void Puzzle::calculate_all_candidates()
             calculate_candidates(i, j);
         }
     }
-    narrow_down_candidates();
 }
 
 /**
@@ -26,147 +27,101 @@ void Puzzle::calculate_all_candidates()
  */
 void Puzzle::calculate_candidates_for_constraint_zone(int x, int y)
 {
-    // check row
-    for (int j = 0; j < gridSize; j++)
+    int cell = x * gridSize + y;
+    calculate_candidates(x, y);
+    for (uint8_t peer : zones::tables.peers[cell])
     {
-        calculate_candidates(x, j);
-    }
-
-    // check col
-    for (int i = 0; i < gridSize; i++)
-    {
-        calculate_candidates(i, y);
-    }
-
-    // check square
-    int ox = (x / squareSize) * squareSize;
-    int oy = (y / squareSize) * squareSize;
-
-    for (int i = ox; i < x + squareSize; i++)
-    {
-        for (int j = oy; j < oy + squareSize; j++)
-        {
-            calculate_candidates(i, j);
-        }
+        calculate_candidates(zones::tables.row[peer], zones::tables.col[peer]);
     }
 }
 
 /**
- * Updates the candidate set at m_candidates[]i[j].
- * Returns early if the cell has no more possible candidates.
+ * Updates the candidate set at m_candidates[i][j], by removing the symbols
+ * already assigned to the cells that share a constraint zone with it.
+ * Assigned cells have no candidates.
  */
 void Puzzle::calculate_candidates(uint8_t i, uint8_t j)
 {
     if (m_board[i][j] != symbol::unassigned_symbol)
     {
+        m_candidates[i][j] = 0;
         return;
     }
 
-    m_candidates[i][j] = 0b111111111;
-
-    // check square
-    for (int x = ((i / squareSize) * squareSize); x < ((i / squareSize) + 1) * squareSize; x++)
-    {
-        for (int y = ((j / squareSize) * squareSize); y < ((j / squareSize) + 1) * squareSize; y++)
-        {
-            if (m_board[x][y] != symbol::unassigned_symbol)
-            {
-                // unset the ith bit for the ith symbol
-                m_candidates[i][j] &= ~(symbol::get_symbol_mask(m_board[x][y]));
-            }
-        }
-    }
-    if (m_candidates[i][j] == 0)
-    {
-        return;
-    }
-
-    // check row
-    for (int y = 0; y < gridSize; y++)
+    const char *board = board_cells();
+    uint16_t candidates = 0b111111111;
+    for (uint8_t peer : zones::tables.peers[i * gridSize + j])
     {
-        if (m_board[i][y] != symbol::unassigned_symbol)
+        if (board[peer] != symbol::unassigned_symbol)
         {
-            m_candidates[i][j] &= ~(symbol::get_symbol_mask(m_board[i][y]));
+            // unset the ith bit for the ith symbol
+            candidates &= ~(symbol::get_symbol_mask(board[peer]));
         }
     }
-    if (m_candidates[i][j] == 0)
-    {
-        return;
-    }
-
-    // check col
-    for (int x = 0; x < gridSize; x++)
-    {
-        if (m_board[x][j] != symbol::unassigned_symbol)
-        {
-            m_candidates[i][j] &= ~(symbol::get_symbol_mask(m_board[x][j]));
-        }
-    }
-    if (m_candidates[i][j] == 0)
-    {
-        return;
-    }
+    m_candidates[i][j] = candidates;
 }
 
 /**
  * For a square, if a symbol is only a candidate for cells in one row/column, then we
  * can remove that symbol from any candidate sets for that row/column in other squares.
+ * Returns the amount of candidates removed.
  */
-void Puzzle::narrow_down_candidates()
+BITOPS_CLONES int Puzzle::narrow_down_candidates()
 {
+    int eliminations = 0;
 
     for (int offset = 0; offset < gridSize; offset++)
     {
         int x = (offset / squareSize) * squareSize;
         int y = (offset % squareSize) * squareSize;
 
-        // you could replace this with a counter, and a row variable, similar to what you did in other methods
-        std::unordered_set<size_t> rows_symbol_is_candidate_in[numSymbols];
-        std::unordered_set<size_t> cols_symbol_is_candidate_in[numSymbols];
-
         for (char symbol = symbol::first_symbol; symbol <= symbol::last_symbol; symbol++)
         {
-            uint8_t symbol_index = symbol::get_symbol_index(symbol);
             uint16_t symbol_mask = symbol::get_symbol_mask(symbol);
+
+            // bit k is set if the symbol is a candidate in row/col x + k / y + k of the square.
+            uint8_t rows_symbol_is_candidate_in = 0;
+            uint8_t cols_symbol_is_candidate_in = 0;
             for (int i = x; i < x + squareSize; i++)
             {
                 for (int j = y; j < y + squareSize; j++)
                 {
                     if (m_candidates[i][j] & symbol_mask)
                     {
-                        rows_symbol_is_candidate_in[symbol_index].insert(i);
-                        cols_symbol_is_candidate_in[symbol_index].insert(j);
+                        rows_symbol_is_candidate_in |= 1 << (i - x);
+                        cols_symbol_is_candidate_in |= 1 << (j - y);
                     }
                 }
             }
 
-            // if size is 1, we can remove this symbol from cells in this row in other squares
-            if (rows_symbol_is_candidate_in[symbol_index].size() == 1)
+            // if there is only one such row, we can remove this symbol from cells in this row in other squares
+            if (bitops::popcount(rows_symbol_is_candidate_in) == 1)
             {
-                size_t row = *rows_symbol_is_candidate_in[symbol_index].begin();
-                for (int j = 0; j < y; j++)
+                size_t row = x + bitops::lowest_bit(rows_symbol_is_candidate_in);
+                for (int j = 0; j < gridSize; j++)
                 {
-                    m_candidates[row][j] &= ~symbol_mask;
-                }
-                for (int j = y + squareSize; j < gridSize; j++)
-                {
-                    m_candidates[row][j] &= ~symbol_mask;
+                    if ((j < y || j >= y + squareSize) && (m_candidates[row][j] & symbol_mask))
+                    {
+                        m_candidates[row][j] &= ~symbol_mask;
+                        eliminations++;
+                    }
                 }
             }
-            if (cols_symbol_is_candidate_in[symbol_index].size() == 1)
+            if (bitops::popcount(cols_symbol_is_candidate_in) == 1)
             {
-                size_t col = *cols_symbol_is_candidate_in[symbol_index].begin();
-                for (int i = 0; i < x; i++)
+                size_t col = y + bitops::lowest_bit(cols_symbol_is_candidate_in);
+                for (int i = 0; i < gridSize; i++)
                 {
-                    m_candidates[i][col] &= ~symbol_mask;
-                }
-                for (int i = x + squareSize; i < gridSize; i++)
-                {
-                    m_candidates[i][col] &= ~symbol_mask;
+                    if ((i < x || i >= x + squareSize) && (m_candidates[i][col] & symbol_mask))
+                    {
+                        m_candidates[i][col] &= ~symbol_mask;
+                        eliminations++;
+                    }
                 }
             }
         }
     }
+    return eliminations;
 }
 
 /**
@@ -177,36 +132,14 @@ void Puzzle::narrow_down_candidates()
  */
 void Puzzle::remove_symbol_from_candidates_in_constraint_zones(uint8_t row, uint8_t col, char symbol)
 {
+    const char *board = board_cells();
+    uint16_t *candidates = candidate_cells();
     uint16_t symbol_mask = symbol::get_symbol_mask(symbol);
-    // row
-    for (uint8_t j = 0; j < gridSize; j++)
+    for (uint8_t peer : zones::tables.peers[row * gridSize + col])
     {
-        if (m_board[row][j] == symbol::unassigned_symbol && (m_candidates[row][j] & symbol_mask))
+        if (board[peer] == symbol::unassigned_symbol)
         {
-            m_candidates[row][j] &= ~symbol_mask;
-        }
-    }
-
-    // col
-    for (uint8_t i = 0; i < gridSize; i++)
-    {
-        if (m_board[i][col] == symbol::unassigned_symbol && (m_candidates[i][col] & symbol_mask))
-        {
-            m_candidates[i][col] &= ~symbol_mask;
-        }
-    }
-
-    // square
-    uint8_t ox = (row / squareSize) * squareSize;
-    uint8_t oy = (col / squareSize) * squareSize;
-    for (uint8_t i = ox; i < ox + squareSize; i++)
-    {
-        for (uint8_t j = oy; j < oy + squareSize; j++)
-        {
-            if (m_board[i][j] == symbol::unassigned_symbol && (m_candidates[i][j] & symbol_mask))
-            {
-                m_candidates[i][j] &= ~symbol_mask;
-            }
+            candidates[peer] &= ~symbol_mask;
         }
     }
 }
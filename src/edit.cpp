@@ -0,0 +1,65 @@
+#include "puzzle.hpp"
+#include "symbol.hpp"
+#include "zones.hpp"
+
+/**
+ * Edits a clue of an already solved puzzle. In order of increasing cost:
+ * - removing a clue, or setting the symbol the solution already has, keeps the solution.
+ * - otherwise the cell gets the new symbol, every non-clue cell in its row, column and
+ *   square is unassigned, and the search continues from the rest of the current solution.
+ * - if no solution extends the rest of the current solution, the puzzle is solved from its clues.
+ * If the puzzle was not solved before the edit, it is solved from its clues.
+ */
+SolveStatus Puzzle::edit_clue(uint8_t row, uint8_t col, char symbol)
+{
+    char *board = board_cells();
+    const char *clues = reinterpret_cast<const char *>(m_clues);
+    int cell = row * gridSize + col;
+    bool was_solved = count_unassigned_cells() == 0 && is_legal();
+
+    m_clues[row][col] = symbol;
+
+    // the counters describe this edit only, as after reset().
+    m_num_restarts = 0;
+    m_num_table_hits = 0;
+    m_num_table_misses = 0;
+    m_num_logic_assignments = 0;
+    m_num_backtracking_guesses = 0;
+    m_portfolio_winner = -1;
+    m_deadline = std::chrono::steady_clock::now() + m_limits.time_budget;
+
+    if (was_solved && (symbol == symbol::unassigned_symbol || board[cell] == symbol))
+    {
+        return SolveStatus::solved;
+    }
+
+    // the new clue can conflict with the other clues, then no solution exists.
+    for (uint8_t peer : zones::tables.peers[cell])
+    {
+        if (symbol != symbol::unassigned_symbol && clues[peer] == symbol)
+        {
+            memcpy(m_board, m_clues, sizeof(m_board));
+            return SolveStatus::impossible;
+        }
+    }
+
+    if (was_solved)
+    {
+        board[cell] = symbol;
+        for (uint8_t peer : zones::tables.peers[cell])
+        {
+            if (clues[peer] == symbol::unassigned_symbol)
+            {
+                board[peer] = symbol::unassigned_symbol;
+            }
+        }
+        SolveStatus status = backtracking();
+        if (status != SolveStatus::impossible)
+        {
+            return status;
+        }
+    }
+
+    memcpy(m_board, m_clues, sizeof(m_board));
+    return solve();
+}
@@ -0,0 +1,221 @@
+#include "expand.hpp"
+#include "colors.hpp"
+#include "puzzle.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    const int line_size = Puzzle::gridSize * Puzzle::gridSize + 1;
+
+    const uint8_t permutations_of_3[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+    uint64_t splitmix64(uint64_t &state)
+    {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * Maps a counter to a transform index with k -> (multiplier * k + offset) mod num_grid_transforms,
+     * which is a bijection because the multiplier shares no prime factor (2, 3, 5, 7) with it.
+     * Consecutive counters are one addition apart.
+     */
+    struct TransformScramble
+    {
+        uint64_t multiplier;
+        uint64_t offset;
+
+        explicit TransformScramble(uint64_t seed)
+        {
+            uint64_t state = seed;
+            multiplier = splitmix64(state) % num_grid_transforms;
+            while (multiplier % 2 == 0 || multiplier % 3 == 0 || multiplier % 5 == 0 || multiplier % 7 == 0)
+            {
+                multiplier = (multiplier + 1) % num_grid_transforms;
+            }
+            offset = splitmix64(state) % num_grid_transforms;
+        }
+
+        uint64_t operator()(uint64_t k) const
+        {
+            return uint64_t(((unsigned __int128)multiplier * k + offset) % num_grid_transforms);
+        }
+
+        // The transform index of k + 1, given that of k.
+        uint64_t next(uint64_t transform_index) const
+        {
+            transform_index += multiplier;
+            return transform_index >= num_grid_transforms ? transform_index - num_grid_transforms : transform_index;
+        }
+    };
+
+    // Permutes 0-2 inside each group of three, and the groups, after the given indices (< 6).
+    void decode_lines(uint64_t &index, uint8_t lines[9])
+    {
+        const uint8_t *groups = permutations_of_3[index % 6];
+        index /= 6;
+        for (int g = 0; g < 3; g++)
+        {
+            const uint8_t *within = permutations_of_3[index % 6];
+            index /= 6;
+            for (int k = 0; k < 3; k++)
+            {
+                lines[g * 3 + k] = groups[g] * 3 + within[k];
+            }
+        }
+    }
+}
+
+GridTransform decode_grid_transform(uint64_t index)
+{
+    GridTransform transform;
+    transform.transpose = index % 2;
+    index /= 2;
+    decode_lines(index, transform.rows);
+    decode_lines(index, transform.cols);
+
+    // the remaining index (< 9!) is the digit permutation in the factorial number system.
+    uint32_t digit_index = uint32_t(index);
+    char unused[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    transform.digits[0] = '0';
+    for (int left = 9; left > 0; left--)
+    {
+        int pick = digit_index % left;
+        digit_index /= left;
+        transform.digits[10 - left] = unused[pick];
+        unused[pick] = unused[left - 1];
+    }
+    return transform;
+}
+
+void apply_grid_transform(const GridTransform &transform, const char *puzzle, char *out)
+{
+    for (int row = 0; row < 9; row++)
+    {
+        for (int col = 0; col < 9; col++)
+        {
+            int source_row = transform.rows[row];
+            int source_col = transform.cols[col];
+            int source = transform.transpose ? source_col * 9 + source_row : source_row * 9 + source_col;
+            out[row * 9 + col] = transform.digits[puzzle[source] - '0'];
+        }
+    }
+}
+
+bool expand_puzzles(const std::string &seeds_path, long long count, const std::string &output_path,
+                    uint64_t seed, int threads)
+{
+    std::ifstream seeds_file(seeds_path);
+    if (!seeds_file)
+    {
+        std::cout << Color::red << "Could not open file: " << Color::purple << seeds_path << Color::endl;
+        return false;
+    }
+    std::vector<std::string> seeds;
+    int skipped = 0;
+    for (std::string line; std::getline(seeds_file, line);)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        // corpus lines may be followed by their solution.
+        std::string puzzle = line.substr(0, line.find(' '));
+        if (Puzzle::is_valid_puzzle_string(puzzle.c_str(), puzzle.size()))
+        {
+            seeds.push_back(puzzle);
+        }
+        else if (!line.empty())
+        {
+            skipped++;
+        }
+    }
+    if (seeds.empty())
+    {
+        std::cout << Color::red << "No puzzles in: " << Color::purple << seeds_path << Color::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t output_size = size_t(count) * line_size;
+    int fd = ::open(output_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, output_size) != 0)
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << output_path << Color::endl;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    char *output = nullptr;
+    if (output_size > 0)
+    {
+        void *mapping = mmap(nullptr, output_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            std::cout << Color::red << "Could not map file: " << Color::purple << output_path << Color::endl;
+            close(fd);
+            return false;
+        }
+        output = static_cast<char *>(mapping);
+    }
+    close(fd);
+
+    // puzzle i is a transform of seed i % seeds.size(), with transform scramble(i), so that even
+    // repeated seed puzzles get distinct transforms.
+    TransformScramble scramble(seed);
+    auto worker = [&](int thread) {
+        size_t begin = size_t(count) * thread / threads;
+        size_t end = size_t(count) * (thread + 1) / threads;
+        uint64_t transform_index = scramble(begin);
+        for (size_t index = begin; index < end; index++, transform_index = scramble.next(transform_index))
+        {
+            GridTransform transform = decode_grid_transform(transform_index);
+            char *out = output + index * line_size;
+            apply_grid_transform(transform, seeds[index % seeds.size()].data(), out);
+            out[line_size - 1] = '\n';
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+    if (output)
+    {
+        munmap(output, output_size);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << Color::green << "Wrote "
+              << Color::yellow << count
+              << Color::green << " puzzles from "
+              << Color::yellow << seeds.size()
+              << Color::green << " seed puzzles in "
+              << Color::yellow << elapsed.count() << " s"
+              << Color::green << " ("
+              << Color::yellow << output_size / 1e9 / std::max(elapsed.count(), 1e-9) << " GB/s"
+              << Color::green << ")." << Color::endl;
+    if (skipped > 0)
+    {
+        std::cout << Color::teal << "Skipped " << Color::yellow << skipped << Color::teal
+                  << " lines that are not puzzles." << Color::endl;
+    }
+    return true;
+}
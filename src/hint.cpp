@@ -0,0 +1,283 @@
+#include "hint.hpp"
+#include "colors.hpp"
+#include "symbol.hpp"
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const int num_digits = zones::grid_size;
+    const uint16_t all_digits = (1 << num_digits) - 1;
+
+    // rows of a box zone's positions, and columns (position p is at row p / 3, column p % 3).
+    const uint16_t box_row_positions = 0b000000111;
+    const uint16_t box_col_positions = 0b001001001;
+
+    bool is_single(uint16_t mask)
+    {
+        return mask && !(mask & (mask - 1));
+    }
+
+    // The position of the cell within zone (the zone must contain the cell).
+    int position_in_zone(int zone, int cell)
+    {
+        int row = zones::tables.row[cell];
+        int col = zones::tables.col[cell];
+        if (zone < zones::grid_size)
+        {
+            return col;
+        }
+        if (zone < 2 * zones::grid_size)
+        {
+            return row;
+        }
+        return (row % zones::square_size) * zones::square_size + col % zones::square_size;
+    }
+
+    // "r3c5", 1-based.
+    std::string cell_name(int cell)
+    {
+        std::string name = "r";
+        name += char('1' + zones::tables.row[cell]);
+        name += 'c';
+        name += char('1' + zones::tables.col[cell]);
+        return name;
+    }
+}
+
+const char *get_step_rule_name(StepRule rule)
+{
+    switch (rule)
+    {
+    case StepRule::naked_single:
+        return "naked single";
+    case StepRule::hidden_single_row:
+        return "hidden single in row";
+    case StepRule::hidden_single_col:
+        return "hidden single in column";
+    case StepRule::hidden_single_box:
+        return "hidden single in box";
+    case StepRule::box_line:
+        return "box-line reduction";
+    }
+    return "unknown";
+}
+
+bool HintSession::load(const char *puzzle, size_t length)
+{
+    if (length != zones::num_cells)
+    {
+        return false;
+    }
+    for (size_t cell = 0; cell < length; cell++)
+    {
+        if (puzzle[cell] < symbol::unassigned_symbol || puzzle[cell] > symbol::last_symbol)
+        {
+            return false;
+        }
+    }
+
+    memset(m_board, symbol::unassigned_symbol, sizeof(m_board));
+    m_num_unassigned = zones::num_cells;
+    for (int cell = 0; cell < zones::num_cells; cell++)
+    {
+        m_candidates[cell] = all_digits;
+    }
+    for (int zone = 0; zone < zones::num_zones; zone++)
+    {
+        for (int digit = 0; digit < num_digits; digit++)
+        {
+            m_positions[zone][digit] = all_digits;
+        }
+    }
+    for (int cell = 0; cell < zones::num_cells; cell++)
+    {
+        if (puzzle[cell] != symbol::unassigned_symbol && !place(cell, puzzle[cell]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Removes the digit from the candidates of the cell, and the cell from the digit's positions
+ * in the cell's zones.
+ */
+void HintSession::eliminate(int cell, int digit)
+{
+    uint16_t digit_mask = 1 << digit;
+    if (!(m_candidates[cell] & digit_mask))
+    {
+        return;
+    }
+    m_candidates[cell] &= ~digit_mask;
+    for (uint8_t zone : zones::tables.cell_zones[cell])
+    {
+        m_positions[zone][digit] &= ~(1 << position_in_zone(zone, cell));
+    }
+}
+
+bool HintSession::place(int cell, char symbol)
+{
+    int digit = symbol::get_symbol_index(symbol);
+    if (m_board[cell] != symbol::unassigned_symbol || !(m_candidates[cell] & (1 << digit)))
+    {
+        return false;
+    }
+    for (uint16_t remaining = m_candidates[cell]; remaining; remaining &= remaining - 1)
+    {
+        eliminate(cell, __builtin_ctz(remaining));
+    }
+    m_board[cell] = symbol;
+    m_num_unassigned--;
+    for (uint8_t peer : zones::tables.peers[cell])
+    {
+        eliminate(peer, digit);
+    }
+    return true;
+}
+
+bool HintSession::next_step(Step &step) const
+{
+    if (is_solved())
+    {
+        return false;
+    }
+    step.num_eliminated = 0;
+    step.box = 0;
+    step.line = 0;
+
+    for (int cell = 0; cell < zones::num_cells; cell++)
+    {
+        if (is_single(m_candidates[cell]))
+        {
+            step.rule = StepRule::naked_single;
+            step.cell = cell;
+            step.symbol = symbol::first_symbol + __builtin_ctz(m_candidates[cell]);
+            return true;
+        }
+    }
+
+    for (int zone = 0; zone < zones::num_zones; zone++)
+    {
+        for (int digit = 0; digit < num_digits; digit++)
+        {
+            if (is_single(m_positions[zone][digit]))
+            {
+                step.rule = zone < zones::grid_size       ? StepRule::hidden_single_row
+                            : zone < 2 * zones::grid_size ? StepRule::hidden_single_col
+                                                          : StepRule::hidden_single_box;
+                step.cell = zones::tables.cells[zone][__builtin_ctz(m_positions[zone][digit])];
+                step.symbol = symbol::first_symbol + digit;
+                return true;
+            }
+        }
+    }
+
+    for (int box = 0; box < zones::grid_size; box++)
+    {
+        int box_zone = 2 * zones::grid_size + box;
+        int first_row = (box / zones::square_size) * zones::square_size;
+        int first_col = (box % zones::square_size) * zones::square_size;
+        for (int digit = 0; digit < num_digits; digit++)
+        {
+            uint16_t positions = m_positions[box_zone][digit];
+            if (!positions)
+            {
+                continue;
+            }
+            for (int k = 0; k < zones::square_size; k++)
+            {
+                // the line is a row or a column zone, and the box covers three of its positions.
+                int line = -1;
+                if (!(positions & ~(box_row_positions << (k * zones::square_size))))
+                {
+                    line = first_row + k;
+                }
+                else if (!(positions & ~(box_col_positions << k)))
+                {
+                    line = zones::grid_size + first_col + k;
+                }
+                if (line < 0)
+                {
+                    continue;
+                }
+                int first_covered = line < zones::grid_size ? first_col : first_row;
+                uint16_t outside = m_positions[line][digit] & ~(box_row_positions << first_covered);
+                if (!outside)
+                {
+                    continue;
+                }
+                step.rule = StepRule::box_line;
+                step.symbol = symbol::first_symbol + digit;
+                step.box = box_zone;
+                step.line = line;
+                for (; outside; outside &= outside - 1)
+                {
+                    step.eliminated[step.num_eliminated++] = zones::tables.cells[line][__builtin_ctz(outside)];
+                }
+                step.cell = step.eliminated[0];
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void HintSession::apply(const Step &step)
+{
+    if (step.rule != StepRule::box_line)
+    {
+        place(step.cell, step.symbol);
+        return;
+    }
+    int digit = symbol::get_symbol_index(step.symbol);
+    for (int e = 0; e < step.num_eliminated; e++)
+    {
+        eliminate(step.eliminated[e], digit);
+    }
+}
+
+bool print_hints(const std::string &puzzle)
+{
+    HintSession session;
+    if (!session.load(puzzle.c_str(), puzzle.size()))
+    {
+        std::cout << Color::red << "Puzzle: '" << puzzle << "' is invalid or illegal." << Color::endl;
+        return false;
+    }
+
+    int num_steps = 0;
+    for (Step step; session.next_step(step); session.apply(step))
+    {
+        std::cout << Color::teal << "Step " << ++num_steps << ": " << get_step_rule_name(step.rule) << ", "
+                  << Color::yellow << step.symbol << Color::teal;
+        if (step.rule != StepRule::box_line)
+        {
+            std::cout << " in " << cell_name(step.cell) << Color::endl;
+            continue;
+        }
+        std::cout << " of box " << step.box - 2 * zones::grid_size + 1 << " lies in "
+                  << (step.line < zones::grid_size ? "row " : "column ") << step.line % zones::grid_size + 1
+                  << ", removed from";
+        for (int e = 0; e < step.num_eliminated; e++)
+        {
+            std::cout << " " << cell_name(step.eliminated[e]);
+        }
+        std::cout << Color::endl;
+    }
+
+    if (session.is_solved())
+    {
+        std::cout << Color::green << "Solved in " << Color::yellow << num_steps << Color::green << " steps."
+                  << Color::endl;
+    }
+    else
+    {
+        std::cout << Color::red << "No rule applies after " << Color::yellow << num_steps
+                  << Color::red << " steps, the rest needs guessing." << Color::endl;
+    }
+    std::cout << Color::blue << session.get_board() << Color::endl;
+    return true;
+}
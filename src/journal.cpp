@@ -0,0 +1,104 @@
+#include "journal.hpp"
+#include "colors.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+Journal::Journal(const std::string &path, bool resume)
+    : m_path(path), m_resume(resume)
+{
+}
+
+Journal Journal::for_shard(int shard) const
+{
+    if (!is_enabled())
+    {
+        return Journal();
+    }
+    return Journal(m_path + ".shard" + std::to_string(shard), m_resume);
+}
+
+bool Journal::load(Progress &progress)
+{
+    if (!m_resume)
+    {
+        return true;
+    }
+    std::ifstream in(m_path);
+    if (!in.is_open())
+    {
+        return true;
+    }
+
+    std::map<std::string, unsigned long long> values;
+    std::string key;
+    unsigned long long value;
+    while (in >> key >> value)
+    {
+        values[key] = value;
+    }
+    Progress journaled;
+    std::pair<const char *, size_t *> fields[] = {
+        {"input_size", &journaled.input_size},
+        {"range_begin", &journaled.range_begin},
+        {"range_end", &journaled.range_end},
+        {"input_offset", &journaled.input_offset},
+        {"line_number", &journaled.line_number},
+        {"results_size", &journaled.results_size},
+    };
+    bool complete = values.count("total") && values.count("count_solved");
+    for (auto [name, field] : fields)
+    {
+        complete = complete && values.count(name);
+        *field = values[name];
+    }
+    journaled.total = values["total"];
+    journaled.count_solved = values["count_solved"];
+
+    if (!complete || !in.eof())
+    {
+        std::cout << Color::red << "Could not read journal: " << Color::purple << m_path << Color::endl;
+        return false;
+    }
+    if (journaled.input_size != progress.input_size || journaled.range_begin != progress.range_begin ||
+        journaled.range_end != progress.range_end || journaled.input_offset < journaled.range_begin ||
+        journaled.input_offset > journaled.range_end)
+    {
+        std::cout << Color::red << "Journal does not match the input file or shard: "
+                  << Color::purple << m_path << Color::endl;
+        return false;
+    }
+
+    progress = journaled;
+    m_resumed = true;
+    std::cout << Color::teal << "Resuming at line "
+              << Color::yellow << progress.line_number
+              << Color::teal << ", after "
+              << Color::yellow << progress.total
+              << Color::teal << " finished puzzles." << Color::endl;
+    return true;
+}
+
+bool Journal::checkpoint(const Progress &progress)
+{
+    m_next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+
+    std::string temp_path = m_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::trunc);
+    out << "input_size " << progress.input_size << '\n'
+        << "range_begin " << progress.range_begin << '\n'
+        << "range_end " << progress.range_end << '\n'
+        << "input_offset " << progress.input_offset << '\n'
+        << "line_number " << progress.line_number << '\n'
+        << "total " << progress.total << '\n'
+        << "count_solved " << progress.count_solved << '\n'
+        << "results_size " << progress.results_size << '\n';
+    out.close();
+    if (!out || std::rename(temp_path.c_str(), m_path.c_str()) != 0)
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << m_path << Color::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,188 @@
+#include "latency.hpp"
+#include "colors.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+size_t LatencyStats::s_slowest_count = 0;
+std::string LatencyStats::s_slowest_path;
+
+/**
+ * Values below sub_bucket_count have a bucket each. Above that, a value with its highest
+ * bit at position e lands in sub-bucket (value >> (e - sub_bucket_bits)) of range e.
+ */
+int LatencyHistogram::get_bucket(uint64_t value)
+{
+    if (value < uint64_t(sub_bucket_count))
+    {
+        return value;
+    }
+    int shift = 63 - __builtin_clzll(value) - sub_bucket_bits;
+    return (shift + 1) * sub_bucket_count + int(value >> shift) - sub_bucket_count;
+}
+
+uint64_t LatencyHistogram::get_bucket_limit(int bucket)
+{
+    if (bucket < sub_bucket_count)
+    {
+        return bucket;
+    }
+    int shift = bucket / sub_bucket_count - 1;
+    uint64_t mantissa = bucket % sub_bucket_count + sub_bucket_count;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    m_counts[get_bucket(value)]++;
+    m_total++;
+    m_max = std::max(m_max, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < num_buckets; i++)
+    {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_total += other.m_total;
+    m_max = std::max(m_max, other.m_max);
+}
+
+uint64_t LatencyHistogram::value_at_percentile(double percentile) const
+{
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(percentile / 100 * m_total + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < num_buckets; i++)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            return std::min(get_bucket_limit(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+/**
+ * Formats a duration with a unit that keeps 3 significant digits.
+ */
+std::string format_duration(uint64_t nanoseconds)
+{
+    std::ostringstream out;
+    out << std::setprecision(3);
+    if (nanoseconds < 1000)
+    {
+        out << nanoseconds << " ns";
+    }
+    else if (nanoseconds < 1000000)
+    {
+        out << nanoseconds / 1e3 << " us";
+    }
+    else if (nanoseconds < 1000000000)
+    {
+        out << nanoseconds / 1e6 << " ms";
+    }
+    else
+    {
+        out << nanoseconds / 1e9 << " s";
+    }
+    return out.str();
+}
+
+bool slower(const LatencyStats::SlowPuzzle &a, const LatencyStats::SlowPuzzle &b)
+{
+    return a.nanoseconds > b.nanoseconds;
+}
+
+void LatencyStats::capture_slowest(size_t count, const std::string &path)
+{
+    s_slowest_count = count;
+    s_slowest_path = path;
+}
+
+void LatencyStats::add_slow_puzzle(const SlowPuzzle &slow)
+{
+    if (m_slowest.size() < s_slowest_count)
+    {
+        m_slowest.push_back(slow);
+        std::push_heap(m_slowest.begin(), m_slowest.end(), slower);
+    }
+    else if (!m_slowest.empty() && slow.nanoseconds > m_slowest.front().nanoseconds)
+    {
+        std::pop_heap(m_slowest.begin(), m_slowest.end(), slower);
+        m_slowest.back() = slow;
+        std::push_heap(m_slowest.begin(), m_slowest.end(), slower);
+    }
+}
+
+void LatencyStats::record(const char *puzzle_str, SolveStatus status, Puzzle &puzzle)
+{
+    if (status == SolveStatus::invalid || status == SolveStatus::illegal)
+    {
+        return;
+    }
+    uint64_t nanoseconds = puzzle.get_solve_time().count();
+    m_histogram.record(nanoseconds);
+    if (s_slowest_count == 0 || (m_slowest.size() == s_slowest_count && nanoseconds <= m_slowest.front().nanoseconds))
+    {
+        return;
+    }
+    SlowPuzzle slow;
+    slow.nanoseconds = nanoseconds;
+    slow.guesses = puzzle.get_num_backtracking_guesses();
+    slow.status = status;
+    memcpy(slow.puzzle, puzzle_str, sizeof(slow.puzzle));
+    memcpy(slow.board, puzzle.get_puzzle_string_view().data(), sizeof(slow.board));
+    add_slow_puzzle(slow);
+}
+
+void LatencyStats::merge(const LatencyStats &other)
+{
+    m_histogram.merge(other.m_histogram);
+    for (const SlowPuzzle &slow : other.m_slowest)
+    {
+        add_slow_puzzle(slow);
+    }
+}
+
+bool LatencyStats::report(const std::string &suffix)
+{
+    if (m_histogram.count() > 0)
+    {
+        const double percentiles[] = {50, 90, 99, 99.9};
+        const char *labels[] = {"p50", "p90", "p99", "p99.9"};
+        std::cout << Color::teal << "Solve time per puzzle:";
+        for (int i = 0; i < 4; i++)
+        {
+            std::cout << " " << labels[i] << " "
+                      << Color::yellow << format_duration(m_histogram.value_at_percentile(percentiles[i]))
+                      << Color::teal << ",";
+        }
+        std::cout << " max " << Color::yellow << format_duration(m_histogram.max()) << Color::endl;
+    }
+    if (s_slowest_path.empty())
+    {
+        return true;
+    }
+
+    std::string path = s_slowest_path + suffix;
+    std::ofstream out(path, std::ios::trunc);
+    std::sort(m_slowest.begin(), m_slowest.end(), slower);
+    for (const SlowPuzzle &slow : m_slowest)
+    {
+        out.write(slow.puzzle, sizeof(slow.puzzle)) << ' ';
+        out.write(slow.board, sizeof(slow.board)) << ' '
+            << get_status_name(slow.status) << ' ' << slow.guesses << ' '
+            << std::fixed << std::setprecision(1) << slow.nanoseconds / 1e3 << '\n';
+    }
+    // the heap order is gone, start over for the next batch.
+    m_slowest.clear();
+    if (!out.flush())
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << path << Color::endl;
+        return false;
+    }
+    return true;
+}
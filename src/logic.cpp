@@ -1,159 +1,142 @@
+#include "bitops.hpp"
 #include "puzzle.hpp"
+#include "rule_stats.hpp"
 #include "symbol.hpp"
+#include "zones.hpp"
 
 /**
- * Calls apply_logic_rules in a loop, and checks the amount of unassigned cells remaining  
- * after each iteration. If the amount is found to no longer be changing, then the
- * logic rules implemented (thus far) are insufficient to solve the current puzzle.
- * If there are no unassigned cells left, the puzzle is solved. 
- * 
- * @returns true when the puzzle is solved, false when it cannot be solved using 
- * the currently implemented logic rules.
+ * Calculates the candidates, and calls apply_logic_rules in a loop, which keeps the candidates
+ * up to date as it goes. If a round of rules no longer changes anything, then the rules of the
+ * pipeline are insufficient to solve the current puzzle.
+ * If there are no unassigned cells left, the puzzle is solved.
+ *
+ * @returns true when the puzzle is solved, false when it cannot be solved using
+ * the rules of the pipeline.
  */
 bool Puzzle::try_to_solve_logically()
 {
-    int unassigned_cells;
-    int prev_unassigned_cells = gridSize * gridSize;
+    calculate_all_candidates();
     while (true)
     {
-        unassigned_cells = apply_logic_rules();
-        if (unassigned_cells == 0)
+        int changes = apply_logic_rules();
+        if (count_unassigned_cells() == 0)
         {
             return true;
         }
-        if (unassigned_cells == prev_unassigned_cells)
+        if (changes == 0)
         {
             return false;
         }
-        prev_unassigned_cells = unassigned_cells;
     }
 }
 
 /**
- * Calculates candidates for cells, and assigns symbols to cells where it is 
- * possible to logically determine a single candidate. Returns the amount of cells
- * that are left unassigned after a round of assignment attempts.
+ * Applies every rule of the pipeline once, in order, and returns the amount of assignments
+ * and candidate eliminations they made. With rule_stats enabled, each application is timed.
  * Some easier puzzles can be solved by calling this function in a loop.
  */
-uint8_t Puzzle::apply_logic_rules()
+int Puzzle::apply_logic_rules()
 {
-    calculate_all_candidates();
-    assign_simple_candidates();
-    find_and_assign_exclusive_candidates();
-    return count_unassigned_cells();
+    bool accounting = rule_stats::is_enabled();
+    int changes = 0;
+    for (int i = 0; i < m_strategy.rules.count; i++)
+    {
+        LogicRule rule = m_strategy.rules.rules[i];
+        auto start = accounting ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        int assignments = 0;
+        int eliminations = 0;
+        switch (rule)
+        {
+        case LogicRule::singles:
+            assignments = assign_simple_candidates();
+            break;
+        case LogicRule::hidden:
+            assignments = find_and_assign_exclusive_candidates();
+            break;
+        case LogicRule::boxline:
+            eliminations = narrow_down_candidates();
+            break;
+        }
+        if (accounting)
+        {
+            rule_stats::record(rule, std::chrono::steady_clock::now() - start, assignments, eliminations);
+        }
+        changes += assignments + eliminations;
+    }
+    return changes;
 }
 
 /**
  * Assigns symbols to cells that only have one possible candidate.
  */
-void Puzzle::assign_simple_candidates()
+BITOPS_CLONES int Puzzle::assign_simple_candidates()
 {
+    int assignments = 0;
     for (int i = 0; i < gridSize; i++)
     {
         for (int j = 0; j < gridSize; j++)
         {
-            uint8_t popcount = std::__popcount(m_candidates[i][j]);
+            uint8_t popcount = bitops::popcount(m_candidates[i][j]);
             if (popcount == 1)
             {
                 char symbol = symbol::get_first_symbol_from_mask(m_candidates[i][j]);
                 m_board[i][j] = symbol;
                 m_num_logic_assignments++;
+                assignments++;
                 m_candidates[i][j] = 0;
                 remove_symbol_from_candidates_in_constraint_zones(i, j, symbol);
             }
         }
     }
+    return assignments;
 }
 
 /**
- * For every symbol, count the amount of unassigned cells in a constraint 
- * zone (row, column, or square), that could possibly have that symbol.
+ * For every constraint zone (row, column, or square), find for every symbol the
+ * unassigned cells in the zone that could possibly have that symbol.
  * If for some constraint zone there is only one cell that can have a certain
  * symbol, then we can assign it to that cell.
  */
-void Puzzle::find_and_assign_exclusive_candidates()
+BITOPS_CLONES int Puzzle::find_and_assign_exclusive_candidates()
 {
-    for (char symbol = '1'; symbol <= '9'; symbol++)
+    const bitops::Kernels *kernels = bitops::active;
+    int assignments = 0;
+    uint16_t *candidates = candidate_cells();
+    uint16_t cells[gridSize];
+    uint16_t positions[numSymbols];
+
+    for (const auto &zone_cells : zones::tables.cells)
     {
-        // check rows
-        for (int i = 0; i < gridSize; i++)
+        for (int p = 0; p < gridSize; p++)
         {
-            int cell_count = 0;
-            int candidate_column = 0;
-            for (int j = 0; j < gridSize; j++)
-            {
-                // if the symbol is a candidate for this cell, increase the count of cells found
-                if (m_candidates[i][j] & symbol::get_symbol_mask(symbol))
-                {
-                    cell_count++;
-                    candidate_column = j;
-                }
-            }
-
-            // if we found only one cell that can have this symbol, assign it.
-            if (cell_count == 1)
-            {
-                m_board[i][candidate_column] = symbol;
-                m_num_logic_assignments++;
-                m_candidates[i][candidate_column] = 0;
-                remove_symbol_from_candidates_in_constraint_zones(i, candidate_column, symbol);
-            }
+            cells[p] = candidates[zone_cells[p]];
         }
 
-        // check cols
-        for (int j = 0; j < gridSize; j++)
-        {
-            int cell_count = 0;
-            int candidate_row = 0;
-            for (int i = 0; i < gridSize; i++)
-            {
-                if (m_candidates[i][j] & symbol::get_symbol_mask(symbol))
-                {
-                    cell_count++;
-                    candidate_row = i;
-                }
-            }
+        kernels->transpose_unit(cells, positions);
 
+        for (int s = 0; s < numSymbols; s++)
+        {
             // if we found only one cell that can have this symbol, assign it.
-            if (cell_count == 1)
+            if (bitops::popcount(positions[s]) != 1)
             {
-                m_board[candidate_row][j] = symbol;
-                m_num_logic_assignments++;
-                m_candidates[candidate_row][j] = 0;
-                remove_symbol_from_candidates_in_constraint_zones(candidate_row, j, symbol);
+                continue;
             }
-        }
+            int cell = zone_cells[bitops::lowest_bit(positions[s])];
+            int row = zones::tables.row[cell];
+            int col = zones::tables.col[cell];
+            char symbol = symbol::first_symbol + s;
 
-        // check every square
-        for (int offset = 0; offset < gridSize; offset++)
-        {
-            int x = (offset / squareSize) * squareSize;
-            int y = (offset % squareSize) * squareSize;
-
-            int cell_count = 0;
-            int candidate_row = 0;
-            int candidate_col = 0;
-            for (int i = x; i < x + squareSize; i++)
+            // an earlier assignment in this zone may have taken the cell, or the candidate.
+            if (!(candidates[cell] & symbol::get_symbol_mask(symbol)))
             {
-                for (int j = y; j < y + squareSize; j++)
-                {
-
-                    if (m_candidates[i][j] & symbol::get_symbol_mask(symbol))
-                    {
-                        cell_count++;
-                        candidate_row = i;
-                        candidate_col = j;
-                    }
-                }
-            }
-            // if we found only one cell that can have this symbol, assign it.
-            if (cell_count == 1)
-            {
-                m_board[candidate_row][candidate_col] = symbol;
-                m_num_logic_assignments++;
-                m_candidates[candidate_row][candidate_col] = 0;
-                remove_symbol_from_candidates_in_constraint_zones(candidate_row, candidate_col, symbol);
+                continue;
             }
+            m_board[row][col] = symbol;
+            m_num_logic_assignments++;
+            assignments++;
+            candidates[cell] = 0;
+            remove_symbol_from_candidates_in_constraint_zones(row, col, symbol);
         }
     }
+    return assignments;
 }
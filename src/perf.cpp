@@ -0,0 +1,192 @@
+#include "perf.hpp"
+#include "colors.hpp"
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    std::atomic<bool> enabled(false);
+
+    // Totals over all threads, and whether any thread could open each counter.
+    std::atomic<uint64_t> totals[perf::num_phases][perf::num_counters];
+    std::atomic<bool> available[perf::num_counters];
+
+    const char *phase_names[perf::num_phases] = {"logic", "backtracking", "io"};
+    const char *counter_names[perf::num_counters] = {"cycles", "instructions", "branch misses",
+                                                     "L1d misses", "LLC misses"};
+
+    struct EventConfig
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    const EventConfig events[perf::num_counters] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    };
+
+    /**
+     * The calling thread's counters, opened as one group so that a single read() returns all
+     * of them. Counters the CPU does not have are left out of the group.
+     */
+    class ThreadCounters
+    {
+    private:
+        int m_fds[perf::num_counters];
+
+        // position of each counter in the group's read() values, -1 if it is not open.
+        int m_slots[perf::num_counters];
+        int m_leader = -1;
+        int m_num_open = 0;
+
+    public:
+        ThreadCounters()
+        {
+            for (int c = 0; c < perf::num_counters; c++)
+            {
+                perf_event_attr attr = {};
+                attr.size = sizeof(attr);
+                attr.type = events[c].type;
+                attr.config = events[c].config;
+                attr.read_format = PERF_FORMAT_GROUP;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                // pid 0 and cpu -1: the calling thread, on whichever CPU it runs.
+                m_fds[c] = syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0);
+                m_slots[c] = m_fds[c] >= 0 ? m_num_open++ : -1;
+                if (m_fds[c] >= 0)
+                {
+                    available[c] = true;
+                    if (m_leader < 0)
+                    {
+                        m_leader = m_fds[c];
+                    }
+                }
+            }
+        }
+
+        ~ThreadCounters()
+        {
+            for (int fd : m_fds)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        }
+
+        /**
+         * Reads the current counter values, 0 for the ones that are not open.
+         * @returns false if no counter could be read.
+         */
+        bool read(uint64_t values[perf::num_counters])
+        {
+            uint64_t buffer[1 + perf::num_counters];
+            if (m_leader < 0 || ::read(m_leader, buffer, sizeof(buffer)) < ssize_t((1 + m_num_open) * sizeof(uint64_t)))
+            {
+                return false;
+            }
+            for (int c = 0; c < perf::num_counters; c++)
+            {
+                values[c] = m_slots[c] >= 0 ? buffer[1 + m_slots[c]] : 0;
+            }
+            return true;
+        }
+    };
+
+    ThreadCounters &get_thread_counters()
+    {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+}
+
+void perf::enable()
+{
+    enabled = true;
+}
+
+bool perf::is_enabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+perf::Scope::Scope(Phase phase) : m_phase(phase)
+{
+    if (is_enabled())
+    {
+        m_active = get_thread_counters().read(m_start);
+    }
+}
+
+perf::Scope::~Scope()
+{
+    uint64_t end[num_counters];
+    if (!m_active || !get_thread_counters().read(end))
+    {
+        return;
+    }
+    for (int c = 0; c < num_counters; c++)
+    {
+        totals[int(m_phase)][c].fetch_add(end[c] - m_start[c], std::memory_order_relaxed);
+    }
+}
+
+void perf::print_report()
+{
+    bool any_available = false;
+    for (auto &counter : available)
+    {
+        any_available |= counter.load();
+    }
+    if (!any_available)
+    {
+        std::cout << Color::teal << "Hardware performance counters are not available." << Color::endl;
+        return;
+    }
+
+    const int name_width = 14;
+    const int value_width = 16;
+    std::cout << Color::green << "Hardware performance counters:" << Color::endl
+              << std::setw(name_width) << std::left << "phase" << std::right;
+    for (const char *name : counter_names)
+    {
+        std::cout << std::setw(value_width) << name;
+    }
+    std::cout << std::setw(8) << "IPC" << '\n';
+
+    for (int p = 0; p < num_phases; p++)
+    {
+        std::cout << std::setw(name_width) << std::left << phase_names[p] << std::right;
+        for (int c = 0; c < num_counters; c++)
+        {
+            if (available[c])
+            {
+                std::cout << std::setw(value_width) << totals[p][c].load();
+            }
+            else
+            {
+                std::cout << std::setw(value_width) << "-";
+            }
+        }
+        uint64_t cycles = totals[p][int(Counter::cycles)];
+        uint64_t instructions = totals[p][int(Counter::instructions)];
+        if (cycles && instructions)
+        {
+            std::cout << std::setw(8) << std::fixed << std::setprecision(2) << double(instructions) / cycles
+                      << std::defaultfloat;
+        }
+        std::cout << '\n';
+    }
+    std::cout << std::flush;
+}
@@ -0,0 +1,254 @@
+#include "portfolio.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+SearchStrategy portfolio::get_member_strategy(int member, const SearchStrategy &base)
+{
+    SearchStrategy strategy = base;
+    strategy.engine = Engine::classic;
+    strategy.branching = Branching::fewest;
+    strategy.value_order = ValueOrder::descending;
+    strategy.seed = base.seed + member;
+    strategy.restart_unit = 0;
+    strategy.table_megabytes = 0;
+    strategy.portfolio_threads = 0;
+    switch (member)
+    {
+    case 0:
+        strategy.engine = Engine::band;
+        break;
+    case 1:
+        strategy.value_order = ValueOrder::least_constraining;
+        break;
+    case 2:
+        parse_logic_pipeline("none", strategy.rules);
+        break;
+    case 3:
+        strategy.branching = Branching::first;
+        strategy.value_order = ValueOrder::random;
+        strategy.restart_unit = 1024;
+        break;
+    default:
+        strategy.value_order = ValueOrder::random;
+        strategy.restart_unit = 256;
+        break;
+    }
+    return strategy;
+}
+
+const char *portfolio::get_member_name(int member)
+{
+    switch (member)
+    {
+    case 0:
+        return "band engine";
+    case 1:
+        return "mrv, lcv";
+    case 2:
+        return "mrv, no logic rules";
+    case 3:
+        return "random restarts";
+    default:
+        return "mrv, random restarts";
+    }
+}
+
+namespace
+{
+    struct Outcome
+    {
+        SolveStatus status = SolveStatus::cancelled;
+        int logic_assignments = 0;
+        int guesses = 0;
+        char board[Puzzle::gridSize * Puzzle::gridSize];
+    };
+
+    // A puzzle handed to the members, with the limits and strategy they derive theirs from.
+    struct Race
+    {
+        char clues[Puzzle::gridSize * Puzzle::gridSize];
+        SearchLimits limits;
+        const SearchStrategy *strategy = nullptr;
+        std::chrono::steady_clock::time_point deadline;
+        std::atomic<bool> decided{false};
+        std::atomic<int> winner{-1};
+    };
+
+    /**
+     * The member threads of the races one thread runs. They are started by its first race and
+     * wait for the next one, so every member thread keeps its solver context, trace buffer and
+     * perf counters from race to race, and a race allocates nothing. Stops and joins the
+     * members when the thread that owns the pool exits.
+     */
+    class MemberPool
+    {
+    private:
+        std::vector<std::thread> m_threads;
+        std::vector<Outcome> m_outcomes;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_finished;
+        Race *m_race = nullptr;
+        long long m_num_races = 0;
+        int m_num_running = 0;
+        bool m_stopping = false;
+
+        void run_member(int member, Race &race)
+        {
+            SearchLimits member_limits = race.limits;
+            member_limits.race = &race.decided;
+            if (race.limits.time_budget.count())
+            {
+                member_limits.time_budget = std::max<std::chrono::nanoseconds>(
+                    race.deadline - std::chrono::steady_clock::now(), std::chrono::nanoseconds(1));
+            }
+            Puzzle &puzzle = load_puzzle(race.clues, member_limits,
+                                         portfolio::get_member_strategy(member, *race.strategy));
+            Outcome &outcome = m_outcomes[member];
+            outcome.status = puzzle.solve();
+            outcome.logic_assignments = puzzle.get_num_logic_assignments();
+            outcome.guesses = puzzle.get_num_backtracking_guesses();
+            memcpy(outcome.board, puzzle.get_puzzle_string_view().data(), sizeof(outcome.board));
+            if ((outcome.status == SolveStatus::solved || outcome.status == SolveStatus::impossible) &&
+                !race.decided.exchange(true))
+            {
+                race.winner.store(member);
+            }
+        }
+
+        void serve(int member)
+        {
+            long long num_served = 0;
+            while (true)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stopping || m_num_races != num_served; });
+                if (m_stopping)
+                {
+                    return;
+                }
+                num_served = m_num_races;
+                Race &race = *m_race;
+                lock.unlock();
+
+                run_member(member, race);
+
+                lock.lock();
+                if (--m_num_running == 0)
+                {
+                    m_finished.notify_one();
+                }
+            }
+        }
+
+    public:
+        explicit MemberPool(int size) : m_outcomes(size)
+        {
+            for (int member = 0; member < size; member++)
+            {
+                m_threads.emplace_back(&MemberPool::serve, this, member);
+            }
+        }
+
+        ~MemberPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (std::thread &thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        int get_size() const
+        {
+            return m_threads.size();
+        }
+
+        // Runs the race on every member, and returns once all of them have stopped.
+        void run(Race &race)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_race = &race;
+            m_num_running = m_threads.size();
+            m_num_races++;
+            m_wake.notify_all();
+            m_finished.wait(lock, [&] { return m_num_running == 0; });
+        }
+
+        const Outcome &get_outcome(int member) const
+        {
+            return m_outcomes[member];
+        }
+    };
+
+    // The calling thread's pool with `size` members, (re)started if it has another size.
+    MemberPool &get_member_pool(int size)
+    {
+        thread_local std::unique_ptr<MemberPool> pool;
+        if (!pool || pool->get_size() != size)
+        {
+            pool.reset();
+            pool = std::make_unique<MemberPool>(size);
+        }
+        return *pool;
+    }
+}
+
+/**
+ * Runs the configured strategy within the portfolio's guess budget, and if that runs out
+ * before the search limits do, races portfolio_threads members from the clues, and takes the
+ * board of the first one to decide the puzzle. Every member gets what is left of the guess
+ * and time limits after the default path, and the guesses count those of the default path
+ * and the winner.
+ */
+SolveStatus Puzzle::solve_with_portfolio()
+{
+    m_portfolio_winner = -1;
+    SearchLimits limits = m_limits;
+    long long budget = m_strategy.portfolio_budget;
+    bool budget_applies = !limits.max_guesses || budget < limits.max_guesses;
+    if (budget_applies)
+    {
+        m_limits.max_guesses = budget;
+    }
+    SolveStatus status = solve_with_strategy();
+    m_limits = limits;
+    if (status != SolveStatus::timed_out || !budget_applies || m_num_backtracking_guesses < budget ||
+        (limits.time_budget.count() && std::chrono::steady_clock::now() >= m_deadline))
+    {
+        return status;
+    }
+
+    Race race;
+    memcpy(race.clues, m_clues, sizeof(race.clues));
+    race.limits = limits;
+    if (limits.max_guesses)
+    {
+        race.limits.max_guesses = std::max(limits.max_guesses - m_num_backtracking_guesses, 1LL);
+    }
+    race.strategy = &m_strategy;
+    race.deadline = m_deadline;
+    MemberPool &pool = get_member_pool(m_strategy.portfolio_threads);
+    pool.run(race);
+
+    int winner = race.winner.load();
+    if (winner < 0)
+    {
+        // every member ran out of the search limits.
+        return limits.cancel && limits.cancel->load() ? SolveStatus::cancelled : SolveStatus::timed_out;
+    }
+    const Outcome &outcome = pool.get_outcome(winner);
+    memcpy(m_board, outcome.board, sizeof(m_board));
+    m_num_logic_assignments = outcome.logic_assignments;
+    m_num_backtracking_guesses += outcome.guesses;
+    m_portfolio_winner = winner;
+    return outcome.status;
+}
@@ -55,7 +55,15 @@ void Puzzle::print_board()
     {
         for (uint8_t j = 0; j < gridSize; j++)
         {
-            std::cout << (j % squareSize == 0 ? (Color::borderColor + "| ") : "  ") << Color::end
+            if (j % squareSize == 0)
+            {
+                std::cout << Color::borderColor << "| ";
+            }
+            else
+            {
+                std::cout << "  ";
+            }
+            std::cout << Color::end
                       << Color::symbolColor << (m_board[i][j] > '0' ? m_board[i][j] : ' ')
                       << Color::end
                       << " ";
@@ -77,3 +85,8 @@ std::string Puzzle::get_puzzle_string()
 {
     return std::string((char *)(m_board), sizeof(m_board));
 }
+
+std::string_view Puzzle::get_puzzle_string_view()
+{
+    return std::string_view((char *)(m_board), sizeof(m_board));
+}
@@ -1,6 +1,20 @@
 #include "process_args.hpp"
+#include "batch.hpp"
+#include "bitops.hpp"
 #include "colors.hpp"
+#include "expand.hpp"
+#include "hint.hpp"
+#include "journal.hpp"
+#include "latency.hpp"
+#include "perf.hpp"
 #include "puzzle.hpp"
+#include "rule_stats.hpp"
+#include "store.hpp"
+#include "trace.hpp"
+#include "verify.hpp"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <unordered_set>
@@ -8,8 +22,58 @@
 
 const std::string puzzle_option = "-p";
 const std::string file_option = "-f";
-const std::string usage_string = "usage: sudoku_solver [-p puzzle1 puzzle2 ... puzzleN] [-f puzzle_file_path]";
+const std::string timeout_option = "--timeout";
+const std::string max_guesses_option = "--max-guesses";
+const std::string kernels_option = "--kernels";
+const std::string shard_option = "--shard";
+const std::string procs_option = "--procs";
+const std::string results_option = "--results";
+const std::string records_option = "--records";
+const std::string threads_option = "--threads";
+const std::string solutions_option = "--solutions";
+const std::string engine_option = "--engine";
+const std::string branching_option = "--branching";
+const std::string value_order_option = "--value-order";
+const std::string seed_option = "--seed";
+const std::string restarts_option = "--restarts";
+const std::string table_option = "--table-mb";
+const std::string rules_option = "--rules";
+const std::string portfolio_option = "--portfolio";
+const std::string portfolio_budget_option = "--portfolio-budget";
+const std::string store_option = "--store";
+const std::string store_size_option = "--store-mb";
+const std::string rule_stats_option = "--rule-stats";
+const std::string perf_option = "--perf";
+const std::string trace_option = "--trace";
+const std::string slowest_option = "--slowest";
+const std::string journal_option = "--journal";
+const std::string resume_option = "--resume";
+const std::string merge_command = "merge";
+const std::string verify_command = "verify";
+const std::string hints_command = "hints";
+const std::string expand_command = "expand";
+const std::string usage_string =
+    "usage: sudoku_solver [-p puzzle1 puzzle2 ... puzzleN] [-f puzzle_file_path]\n"
+    "                     [--timeout milliseconds] [--max-guesses count]\n"
+    "                     [--kernels generic|bmi2|avx2]\n"
+    "                     [--results results_path] [--shard i/N] [--procs N]\n"
+    "                     [--records records_path] [--threads N]\n"
+    "                     [--solutions N]\n"
+    "                     [--engine classic|band] [--branching first|mrv]\n"
+    "                     [--value-order descending|lcv|random] [--seed N] [--restarts guesses]\n"
+    "                     [--table-mb megabytes] [--perf] [--trace trace_path]\n"
+    "                     [--rules singles,hidden,boxline|none] [--rule-stats]\n"
+    "                     [--portfolio k] [--portfolio-budget guesses]\n"
+    "                     [--store store_path] [--store-mb megabytes]\n"
+    "                     [--slowest N slowest_path]\n"
+    "                     [--journal journal_path] [--resume]\n"
+    "       sudoku_solver merge output_path results_path1 ... results_pathN\n"
+    "       sudoku_solver verify grids_path [clues_path] [--results results_path]\n"
+    "       sudoku_solver hints puzzle\n"
+    "       sudoku_solver expand seeds_path count output_path [--seed N] [--threads N]";
 std::vector<std::string> args;
+Options options;
+std::atomic<bool> cancel_requested(false);
 
 void print_success_statistic(int count_solved, int total)
 {
@@ -27,6 +91,29 @@ void print_usage()
     std::cout << usage_string << std::endl;
 }
 
+/**
+ * Parses a non-negative integer option value, exits with the usage string if it is not one.
+ */
+long long parse_count(const std::string &option, const char *value)
+{
+    char *end = nullptr;
+    long long count = value ? std::strtoll(value, &end, 10) : -1;
+    if (!value || *end != '\0' || end == value || count < 0)
+    {
+        illegal_option(option + " " + (value ? value : ""));
+        exit(1);
+    }
+    return count;
+}
+
+void handle_sigint(int)
+{
+    cancel_requested.store(true);
+}
+
+/**
+ * Collects the positional arguments into args, and the long options into options.
+ */
 void parse_args(int argc, char *argv[])
 {
     if (argc <= 1)
@@ -39,8 +126,215 @@ void parse_args(int argc, char *argv[])
 
     for (int i = 1; i < argc; i++)
     {
-        args.push_back(std::string(argv[i]));
+        std::string arg(argv[i]);
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == timeout_option)
+        {
+            options.limits.time_budget = std::chrono::milliseconds(parse_count(arg, value));
+            i++;
+        }
+        else if (arg == max_guesses_option)
+        {
+            options.limits.max_guesses = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == kernels_option)
+        {
+            if (!value || !bitops::select(value))
+            {
+                std::cout << Color::red << "Kernels not available on this CPU: " << Color::end
+                          << (value ? value : "") << std::endl;
+                exit(1);
+            }
+            i++;
+        }
+        else if (arg == shard_option)
+        {
+            std::string shard = value ? value : "";
+            size_t slash = shard.find('/');
+            if (slash == std::string::npos)
+            {
+                illegal_option(arg + " " + shard);
+                exit(1);
+            }
+            options.shard_index = parse_count(arg, shard.substr(0, slash).c_str());
+            options.shard_count = parse_count(arg, shard.substr(slash + 1).c_str());
+            if (options.shard_index >= options.shard_count)
+            {
+                illegal_option(arg + " " + shard);
+                exit(1);
+            }
+            i++;
+        }
+        else if (arg == procs_option)
+        {
+            options.procs = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == results_option || arg == records_option || arg == journal_option || arg == store_option)
+        {
+            if (!value)
+            {
+                illegal_option(arg);
+                exit(1);
+            }
+            (arg == results_option   ? options.results_path
+             : arg == records_option ? options.records_path
+             : arg == journal_option ? options.journal_path
+                                     : options.store_path) = value;
+            i++;
+        }
+        else if (arg == store_size_option)
+        {
+            options.store_megabytes = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == resume_option)
+        {
+            options.resume = true;
+        }
+        else if (arg == engine_option)
+        {
+            if (!value || !parse_engine(value, options.strategy.engine))
+            {
+                illegal_option(arg + " " + (value ? value : ""));
+                exit(1);
+            }
+            i++;
+        }
+        else if (arg == branching_option)
+        {
+            if (!value || !parse_branching(value, options.strategy.branching))
+            {
+                illegal_option(arg + " " + (value ? value : ""));
+                exit(1);
+            }
+            i++;
+        }
+        else if (arg == value_order_option)
+        {
+            if (!value || !parse_value_order(value, options.strategy.value_order))
+            {
+                illegal_option(arg + " " + (value ? value : ""));
+                exit(1);
+            }
+            i++;
+        }
+        else if (arg == seed_option)
+        {
+            options.strategy.seed = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == restarts_option)
+        {
+            options.strategy.restart_unit = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == table_option)
+        {
+            options.strategy.table_megabytes = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == rules_option)
+        {
+            if (!value || !parse_logic_pipeline(value, options.strategy.rules))
+            {
+                illegal_option(arg + " " + (value ? value : ""));
+                exit(1);
+            }
+            i++;
+        }
+        else if (arg == portfolio_option)
+        {
+            options.strategy.portfolio_threads = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == portfolio_budget_option)
+        {
+            options.strategy.portfolio_budget = std::max<long long>(parse_count(arg, value), 1);
+            i++;
+        }
+        else if (arg == rule_stats_option)
+        {
+            rule_stats::enable();
+        }
+        else if (arg == solutions_option)
+        {
+            options.max_solutions = parse_count(arg, value);
+            i++;
+        }
+        else if (arg == threads_option)
+        {
+            options.threads = std::max<long long>(parse_count(arg, value), 1);
+            i++;
+        }
+        else if (arg == trace_option)
+        {
+            if (!value)
+            {
+                illegal_option(arg);
+                exit(1);
+            }
+            trace::enable(value);
+            i++;
+        }
+        else if (arg == slowest_option)
+        {
+            size_t count = parse_count(arg, value);
+            if (i + 2 >= argc)
+            {
+                illegal_option(arg + " " + value);
+                exit(1);
+            }
+            LatencyStats::capture_slowest(count, argv[i + 2]);
+            i += 2;
+        }
+        else if (arg == perf_option)
+        {
+            perf::enable();
+        }
+        else if (arg.rfind("--", 0) == 0)
+        {
+            illegal_option(arg);
+            exit(1);
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty())
+    {
+        print_usage();
+        exit(0);
+    }
+    if (options.resume && options.journal_path.empty())
+    {
+        std::cout << Color::red << "--resume requires --journal." << Color::endl;
+        exit(1);
+    }
+
+    if (!options.store_path.empty())
+    {
+        get_solution_store().configure(options.store_path, options.store_megabytes);
+    }
+
+    options.limits.cancel = &cancel_requested;
+    std::signal(SIGINT, handle_sigint);
+}
+
+/**
+ * Prints the solution of the puzzle, or its solutions with --solutions.
+ */
+bool solve_and_print(const std::string &puzzle_str, int count, LatencyStats &stats)
+{
+    trace::set_puzzle(count);
+    if (options.max_solutions >= 0)
+    {
+        return enumerate_puzzle(puzzle_str, count, options.max_solutions, options.limits, options.strategy);
     }
+    return process_puzzle(puzzle_str, count, options.limits, options.strategy, &stats);
 }
 
 void process_puzzles()
@@ -52,11 +346,16 @@ void process_puzzles()
 
     int total = 0;
     int count_solved = 0;
-    for (auto it = args.begin() + 1; it != args.end(); it++)
+    LatencyStats stats;
+    for (auto it = args.begin() + 1; it != args.end() && !cancel_requested; it++)
     {
-        count_solved += process_puzzle(*it, ++total);
+        count_solved += solve_and_print(*it, ++total, stats);
     }
     print_success_statistic(count_solved, total);
+    if (!stats.report())
+    {
+        exit(1);
+    }
 }
 
 void process_args()
@@ -72,16 +371,136 @@ void process_args()
         {
             std::cout << Color::red << "File option requires a filename." << Color::endl;
             print_usage();
+            return;
         }
         process_file(args.at(1));
     }
+    else if (option == merge_command)
+    {
+        if (args.size() < 3)
+        {
+            print_usage();
+            return;
+        }
+        std::vector<std::string> inputs(args.begin() + 2, args.end());
+        if (!merge_results(args.at(1), inputs))
+        {
+            exit(1);
+        }
+    }
+    else if (option == verify_command)
+    {
+        if (args.size() < 2 || args.size() > 3)
+        {
+            print_usage();
+            return;
+        }
+        if (!verify_file(args.at(1), args.size() > 2 ? args.at(2) : "", options.results_path))
+        {
+            exit(1);
+        }
+    }
+    else if (option == hints_command)
+    {
+        if (args.size() != 2)
+        {
+            print_usage();
+            return;
+        }
+        if (!print_hints(args.at(1)))
+        {
+            exit(1);
+        }
+    }
+    else if (option == expand_command)
+    {
+        if (args.size() != 4)
+        {
+            print_usage();
+            return;
+        }
+        long long count = parse_count(expand_command, args.at(2).c_str());
+        if (!expand_puzzles(args.at(1), count, args.at(3), options.strategy.seed, options.threads))
+        {
+            exit(1);
+        }
+    }
+    else
+    {
+        illegal_option(option);
+        return;
+    }
+    if (perf::is_enabled())
+    {
+        perf::print_report();
+    }
+    if (rule_stats::is_enabled())
+    {
+        rule_stats::print_report();
+    }
+    if (get_solution_store().is_enabled())
+    {
+        get_solution_store().print_report();
+    }
+    if (trace::is_enabled() && !trace::write_file())
+    {
+        exit(1);
+    }
+}
+
+/**
+ * getline, counted as I/O by --perf and --trace.
+ */
+bool read_line(std::istream &in, std::string &line)
+{
+    perf::Scope scope(perf::Phase::io);
+    trace::Scope span(trace::Span::read);
+    return bool(getline(in, line));
 }
 
 void process_file(std::string filepath)
 {
-    int total = 0;
-    int count_solved = 0;
-    std::ifstream infile(filepath);
+    Journal journal(options.journal_path, options.resume);
+    if (options.procs > 0 && options.shard_count > 0)
+    {
+        // --procs already splits the whole file into its own shards.
+        std::cout << Color::red << "--procs cannot be combined with --shard." << Color::endl;
+        exit(1);
+    }
+    if (!options.records_path.empty())
+    {
+        if (options.procs > 0 || !options.results_path.empty())
+        {
+            std::cout << Color::red << "--records cannot be combined with --procs or --results." << Color::endl;
+            exit(1);
+        }
+        if (!process_file_records(filepath, options.records_path, options.threads, options.shard_index,
+                                  std::max(options.shard_count, 1), options.limits, options.strategy, journal))
+        {
+            exit(1);
+        }
+        return;
+    }
+    if (options.procs > 0 || options.shard_count > 0 || !options.results_path.empty())
+    {
+        if (options.results_path.empty())
+        {
+            std::cout << Color::red << "--shard and --procs require --results." << Color::endl;
+            exit(1);
+        }
+        bool ok = options.procs > 0
+                      ? process_file_forked(filepath, options.procs, options.results_path,
+                                            options.limits, options.strategy, journal)
+                      : process_file_shard(filepath, options.shard_index, std::max(options.shard_count, 1),
+                                           options.results_path, options.limits, options.strategy, journal);
+        if (!ok)
+        {
+            exit(1);
+        }
+        return;
+    }
+
+    std::ifstream infile(filepath, std::ios::binary);
     if (!infile.is_open())
     {
         std::cout
@@ -89,15 +508,63 @@ void process_file(std::string filepath)
             << Color::endl;
         return;
     }
-    for (std::string line; getline(infile, line);)
+    Progress progress;
+    infile.seekg(0, std::ios::end);
+    progress.input_size = progress.range_end = infile.tellg();
+    if (!journal.load(progress))
+    {
+        exit(1);
+    }
+    infile.seekg(progress.input_offset);
+
+    int total = progress.total;
+    int count_solved = progress.count_solved;
+    LatencyStats stats;
+    bool journal_ok = true;
+    // checkpoints the progress up to the line at offset.
+    auto checkpoint = [&](size_t offset, size_t line_number) {
+        progress.input_offset = std::min(offset, progress.input_size);
+        progress.line_number = line_number;
+        progress.total = total;
+        progress.count_solved = count_solved;
+        journal_ok = journal.checkpoint(progress) && journal_ok;
+    };
+    size_t offset = progress.input_offset;
+    size_t line_number = progress.line_number;
+    for (std::string line; read_line(infile, line); offset += line.size() + 1, line_number++)
     {
         if (line.size() < 1)
         {
             continue;
         }
-        count_solved += process_puzzle(line, ++total);
+        bool solved = solve_and_print(line, total + 1, stats);
+        if (cancel_requested)
+        {
+            // the checkpoint ends before this puzzle, which may have been cancelled.
+            if (journal.is_enabled())
+            {
+                checkpoint(offset, line_number);
+            }
+            count_solved += solved;
+            total++;
+            break;
+        }
+        count_solved += solved;
+        total++;
+        if (journal.is_due())
+        {
+            checkpoint(offset + line.size() + 1, line_number + 1);
+        }
+    }
+    if (journal.is_enabled() && !cancel_requested)
+    {
+        checkpoint(progress.input_size, line_number);
     }
     print_success_statistic(count_solved, total);
+    if (!stats.report() || !journal_ok)
+    {
+        exit(1);
+    }
 }
 
 void illegal_option(std::string arg)
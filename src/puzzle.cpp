@@ -1,10 +1,176 @@
+#include "bitops.hpp"
 #include "colors.hpp"
+#include "latency.hpp"
+#include "perf.hpp"
+#include "portfolio.hpp"
 #include "puzzle.hpp"
+#include "store.hpp"
 #include "symbol.hpp"
+#include "trace.hpp"
 #include "print.hpp"
+#include <algorithm>
 
 const std::string Puzzle::puzzle_regex_str = std::string("[0-9]{81}");
-const std::regex Puzzle::puzzle_regex = std::regex(puzzle_regex_str);
+
+bool Puzzle::is_valid_puzzle_string(const char *puzzle_str, size_t length)
+{
+    if (length != gridSize * gridSize)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        if (puzzle_str[i] < '0' || puzzle_str[i] > '9')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *get_status_name(SolveStatus status)
+{
+    switch (status)
+    {
+    case SolveStatus::solved:
+        return "solved";
+    case SolveStatus::impossible:
+        return "impossible";
+    case SolveStatus::timed_out:
+        return "timed_out";
+    case SolveStatus::cancelled:
+        return "cancelled";
+    case SolveStatus::invalid:
+        return "invalid";
+    case SolveStatus::illegal:
+        return "illegal";
+    }
+    return "unknown";
+}
+
+bool parse_value_order(const std::string &name, ValueOrder &order)
+{
+    if (name == "descending")
+    {
+        order = ValueOrder::descending;
+    }
+    else if (name == "lcv")
+    {
+        order = ValueOrder::least_constraining;
+    }
+    else if (name == "random")
+    {
+        order = ValueOrder::random;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool parse_engine(const std::string &name, Engine &engine)
+{
+    if (name == "classic")
+    {
+        engine = Engine::classic;
+    }
+    else if (name == "band")
+    {
+        engine = Engine::band;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool parse_branching(const std::string &name, Branching &branching)
+{
+    if (name == "first")
+    {
+        branching = Branching::first;
+    }
+    else if (name == "mrv")
+    {
+        branching = Branching::fewest;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char *get_logic_rule_name(LogicRule rule)
+{
+    switch (rule)
+    {
+    case LogicRule::singles:
+        return "singles";
+    case LogicRule::hidden:
+        return "hidden";
+    case LogicRule::boxline:
+        return "boxline";
+    }
+    return "unknown";
+}
+
+bool parse_logic_pipeline(const std::string &names, LogicPipeline &pipeline)
+{
+    LogicPipeline parsed;
+    parsed.count = 0;
+    if (names == "none")
+    {
+        pipeline = parsed;
+        return true;
+    }
+    for (size_t begin = 0; begin <= names.size();)
+    {
+        size_t comma = std::min(names.find(',', begin), names.size());
+        std::string name = names.substr(begin, comma - begin);
+        bool found = false;
+        for (int r = 0; r < num_logic_rules && !found; r++)
+        {
+            LogicRule rule = LogicRule(r);
+            found = name == get_logic_rule_name(rule) &&
+                    std::find(parsed.rules, parsed.rules + parsed.count, rule) == parsed.rules + parsed.count;
+            if (found)
+            {
+                parsed.rules[parsed.count++] = rule;
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+        begin = comma + 1;
+    }
+    pipeline = parsed;
+    return true;
+}
+
+SolverContext &get_solver_context()
+{
+    thread_local SolverContext context;
+    return context;
+}
+
+/**
+ * Loads the puzzle into the calling thread's solver context, to be solved within the limits
+ * and with the strategy. The context's transposition table is only reallocated when its size changes.
+ */
+Puzzle &load_puzzle(const char *puzzle_str, const SearchLimits &limits, const SearchStrategy &strategy)
+{
+    SolverContext &context = get_solver_context();
+    context.table.resize(strategy.table_megabytes);
+    context.puzzle.reset(puzzle_str);
+    context.puzzle.set_limits(limits);
+    context.puzzle.set_strategy(strategy);
+    context.puzzle.set_transposition_table(&context.table);
+    return context.puzzle;
+}
 
 /**
  * Returns the number of cells that do not have a symbol assigned to them yet.
@@ -37,24 +203,17 @@ ScientificNotation Puzzle::num_possible_permutations()
     // Back up the candidates such that this function has no side effects.
     memcpy(m_candidates_backup, m_candidates, sizeof(m_candidates));
     calculate_all_candidates();
+    narrow_down_candidates();
 
     for (int i = 0; i < gridSize; i++)
     {
         for (int j = 0; j < gridSize; j++)
         {
-            int num_candidates_cell = 0;
             if (m_candidates[i][j] == 0)
             {
                 continue;
             }
-            for (int s = 0; s < 9; s++)
-            {
-                if ((1UL << s) & m_candidates[i][j])
-                {
-                    num_candidates_cell++;
-                }
-            }
-            sn *= num_candidates_cell;
+            sn *= bitops::popcount(m_candidates[i][j]);
         }
     }
 
@@ -63,12 +222,69 @@ ScientificNotation Puzzle::num_possible_permutations()
 }
 
 /**
- * Solves the puzzle. @returns true if solved, false, if impossible to solve. 
+ * Solves the puzzle. @returns solved if solved, impossible if impossible to solve, and
+ * timed_out or cancelled if the search limits ran out before either could be determined.
  */
-bool Puzzle::solve()
+SolveStatus Puzzle::solve()
+{
+    auto start = std::chrono::steady_clock::now();
+    m_deadline = start + m_limits.time_budget;
+    SolveStatus status = m_strategy.portfolio_threads > 1 ? solve_with_portfolio() : solve_with_strategy();
+    m_solve_time = std::chrono::steady_clock::now() - start;
+    return status;
+}
+
+SolveStatus Puzzle::solve_with_strategy()
 {
-    try_to_solve_logically();
-    return backtracking();
+    SolveStatus status;
+    if (m_strategy.engine == Engine::band)
+    {
+        // propagation and search are interleaved, all of it counts as search.
+        perf::Scope scope(perf::Phase::backtracking);
+        trace::Scope span(trace::Span::backtracking);
+        status = solve_with_bands();
+    }
+    else
+    {
+        {
+            perf::Scope scope(perf::Phase::logic);
+            trace::Scope span(trace::Span::logic);
+            try_to_solve_logically();
+        }
+        perf::Scope scope(perf::Phase::backtracking);
+        trace::Scope span(trace::Span::backtracking);
+        status = backtracking();
+    }
+    return status;
+}
+
+Generator<std::string_view> Puzzle::solutions()
+{
+    m_deadline = std::chrono::steady_clock::now() + m_limits.time_budget;
+    {
+        perf::Scope scope(perf::Phase::logic);
+        trace::Scope span(trace::Span::logic);
+        try_to_solve_logically();
+    }
+    if (!start_search(true))
+    {
+        m_search_status = SolveStatus::impossible;
+        co_return;
+    }
+    for (bool resume = false;; resume = true)
+    {
+        // no scope may stay open across a co_yield, the caller's code would be counted too.
+        {
+            perf::Scope scope(perf::Phase::backtracking);
+            trace::Scope span(trace::Span::backtracking);
+            m_search_status = continue_search(resume);
+        }
+        if (m_search_status != SolveStatus::solved)
+        {
+            break;
+        }
+        co_yield get_puzzle_string_view();
+    }
 }
 
 /**
@@ -77,9 +293,10 @@ bool Puzzle::solve()
  */
 bool Puzzle::is_legal()
 {
-    std::unordered_set<char> row_symbols[gridSize];
-    std::unordered_set<char> col_symbols[gridSize];
-    std::unordered_set<char> square_symbols[gridSize];
+    trace::Scope span(trace::Span::validate);
+    uint16_t row_symbols[gridSize] = {};
+    uint16_t col_symbols[gridSize] = {};
+    uint16_t square_symbols[gridSize] = {};
 
     for (int i = 0; i < gridSize; i++)
     {
@@ -93,35 +310,131 @@ bool Puzzle::is_legal()
             {
                 continue;
             }
-            if (row_symbols[i].find(symbol) != row_symbols[i].end())
-            {
-                return false;
-            }
-            if (col_symbols[j].find(symbol) != col_symbols[j].end())
+            uint16_t symbol_mask = symbol::get_symbol_mask(symbol);
+            if ((row_symbols[i] | col_symbols[j] | square_symbols[square_index]) & symbol_mask)
             {
                 return false;
             }
-            if (square_symbols[square_index].find(symbol) != square_symbols[square_index].end())
-            {
-                return false;
-            }
-            row_symbols[i].insert(symbol);
-            col_symbols[j].insert(symbol);
-            square_symbols[square_index].insert(symbol);
+            row_symbols[i] |= symbol_mask;
+            col_symbols[j] |= symbol_mask;
+            square_symbols[square_index] |= symbol_mask;
         }
     }
     return true;
 }
 
+SolveStatus solve_loaded_puzzle(Puzzle &puzzle, const char *puzzle_str, bool &from_store)
+{
+    SolutionStore &store = get_solution_store();
+    from_store = false;
+    if (!store.is_enabled())
+    {
+        return puzzle.solve();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SolutionStore::Entry entry;
+    if (store.lookup(puzzle_str, entry))
+    {
+        puzzle.load_stored_result(entry.board, std::chrono::steady_clock::now() - start);
+        from_store = true;
+        return entry.status;
+    }
+    SolveStatus status = puzzle.solve();
+    if (status == SolveStatus::solved || status == SolveStatus::impossible)
+    {
+        entry.status = status;
+        entry.guesses = puzzle.get_num_backtracking_guesses();
+        entry.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(puzzle.get_solve_time()).count();
+        memcpy(entry.board, status == SolveStatus::solved ? puzzle.get_puzzle_string_view().data() : puzzle_str,
+               sizeof(entry.board));
+        store.insert(puzzle_str, entry);
+    }
+    return status;
+}
+
+SolveStatus solve_puzzle_string(const char *puzzle_str, size_t length, const SearchLimits &limits,
+                                const SearchStrategy &strategy)
+{
+    Puzzle &puzzle = get_solver_context().puzzle;
+    if (!Puzzle::is_valid_puzzle_string(puzzle_str, length))
+    {
+        // leave an empty board behind, rather than the previous puzzle.
+        char board[Puzzle::gridSize * Puzzle::gridSize];
+        memset(board, symbol::unassigned_symbol, sizeof(board));
+        puzzle.reset(board);
+        return SolveStatus::invalid;
+    }
+    load_puzzle(puzzle_str, limits, strategy);
+    if (!puzzle.is_legal())
+    {
+        return SolveStatus::illegal;
+    }
+    bool from_store;
+    return solve_loaded_puzzle(puzzle, puzzle_str, from_store);
+}
+
+/**
+ * Verifies that the puzzle is legal, and prints its solutions, one per line, as the search finds them.
+ */
+bool enumerate_puzzle(const std::string &puzzle_str, int count, long long max_solutions,
+                      const SearchLimits &limits, const SearchStrategy &strategy)
+{
+    std::cout << "Puzzle " << count << ":" << std::endl;
+    if (!Puzzle::is_valid_puzzle_string(puzzle_str.c_str(), puzzle_str.size()))
+    {
+        std::cout
+            << "Puzzle: '" << puzzle_str << "' is invalid." << '\n'
+            << "Puzzle strings must follow the pattern: "
+            << Puzzle::puzzle_regex_str << '\n'
+            << std::endl;
+        return false;
+    }
+
+    Puzzle &puzzle = load_puzzle(puzzle_str.c_str(), limits, strategy);
+    if (!puzzle.is_legal())
+    {
+        std::cout << Color::red << "Puzzle is illegal." << Color::endl;
+        return false;
+    }
+
+    long long num_solutions = 0;
+    for (std::string_view solution : puzzle.solutions())
+    {
+        std::cout << Color::blue << solution << Color::end << '\n';
+        if (++num_solutions == max_solutions)
+        {
+            break;
+        }
+    }
+
+    std::cout << Color::green << "Found "
+              << Color::yellow << num_solutions
+              << Color::green << (num_solutions == 1 ? " solution" : " solutions");
+    if (num_solutions == max_solutions)
+    {
+        std::cout << " (stopped at the requested amount)";
+    }
+    else if (puzzle.get_search_status() == SolveStatus::timed_out || puzzle.get_search_status() == SolveStatus::cancelled)
+    {
+        std::cout << Color::red
+                  << (puzzle.get_search_status() == SolveStatus::timed_out ? " before the search timed out"
+                                                                           : " before the search was cancelled");
+    }
+    std::cout << "." << Color::endl;
+    return num_solutions > 0;
+}
+
 /**
  * Verifies that the puzzle is legal, and tries to solve it if so. 
  * Pretty-prints the solution if one is found, otherwise prints feedback explaining the error.
  */
-bool process_puzzle(std::string puzzle_str, int count)
+bool process_puzzle(const std::string &puzzle_str, int count, const SearchLimits &limits,
+                    const SearchStrategy &strategy, LatencyStats *stats)
 {
 
     std::cout << "Puzzle " << count << ":" << std::endl;
-    if (!std::regex_match(puzzle_str, Puzzle::puzzle_regex))
+    if (!Puzzle::is_valid_puzzle_string(puzzle_str.c_str(), puzzle_str.size()))
     {
         std::cout
             << "Puzzle: '" << puzzle_str << "' is invalid." << '\n'
@@ -131,7 +444,7 @@ bool process_puzzle(std::string puzzle_str, int count)
         return false;
     }
 
-    Puzzle puzzle(puzzle_str);
+    Puzzle &puzzle = load_puzzle(puzzle_str.c_str(), limits, strategy);
     if (!puzzle.is_legal())
     {
         std::cout
@@ -146,7 +459,22 @@ bool process_puzzle(std::string puzzle_str, int count)
     int num_unassigned_cells = puzzle.count_unassigned_cells();
     ScientificNotation num_possible_permutations = puzzle.num_possible_permutations();
 
-    if (puzzle.solve())
+    bool from_store;
+    SolveStatus status = solve_loaded_puzzle(puzzle, puzzle_str.c_str(), from_store);
+    if (stats)
+    {
+        stats->record(puzzle_str.c_str(), status, puzzle);
+    }
+    trace::Scope span(trace::Span::write);
+    if (status == SolveStatus::solved && from_store)
+    {
+        std::cout << Color::teal << "Found in the solution store." << Color::endl;
+        std::cout << Color::blue << puzzle.get_puzzle_string_view() << Color::endl;
+        puzzle.print_board();
+        newline();
+        return true;
+    }
+    if (status == SolveStatus::solved)
     {
         int num_logic_assignments = puzzle.get_num_logic_assignments();
         int num_backtracking_guesses = puzzle.get_num_backtracking_guesses();
@@ -170,13 +498,53 @@ bool process_puzzle(std::string puzzle_str, int count)
                 << Color::purple << num_possible_permutations
                 << Color::teal << ")." << Color::endl;
         }
+        if (puzzle.get_portfolio_winner() >= 0)
+        {
+            std::cout
+                << Color::teal << "The default search ran out of its budget, portfolio member "
+                << Color::yellow << puzzle.get_portfolio_winner()
+                << Color::teal << " (" << portfolio::get_member_name(puzzle.get_portfolio_winner())
+                << ") finished first." << Color::endl;
+        }
+        if (puzzle.get_num_restarts() > 0)
+        {
+            std::cout
+                << Color::teal << "The search restarted "
+                << Color::yellow << puzzle.get_num_restarts()
+                << Color::teal << " times." << Color::endl;
+        }
+        if (puzzle.get_num_table_hits() + puzzle.get_num_table_misses() > 0)
+        {
+            std::cout
+                << Color::teal << "The transposition table had "
+                << Color::yellow << puzzle.get_num_table_hits()
+                << Color::teal << " hits and "
+                << Color::yellow << puzzle.get_num_table_misses()
+                << Color::teal << " misses." << Color::endl;
+        }
 
-        std::cout << Color::blue << puzzle.get_puzzle_string() << Color::endl;
+        std::cout << Color::blue << puzzle.get_puzzle_string_view() << Color::endl;
         puzzle.print_board();
         newline();
         return true;
     }
 
+    if (status == SolveStatus::timed_out || status == SolveStatus::cancelled)
+    {
+        std::cout
+            << Color::red
+            << (status == SolveStatus::timed_out ? "Puzzle timed out" : "Puzzle was cancelled")
+            << Color::teal << " after "
+            << Color::yellow << puzzle.get_num_backtracking_guesses()
+            << Color::teal << " guesses, with "
+            << Color::yellow << puzzle.get_num_logic_assignments()
+            << Color::teal << " cells assigned using logic and "
+            << Color::yellow << puzzle.count_unassigned_cells()
+            << Color::teal << " cells still unassigned."
+            << Color::endl;
+        return false;
+    }
+
     std::cout
         << Color::red
         << "Puzzle is impossible to solve. " << std::endl
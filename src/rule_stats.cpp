@@ -0,0 +1,89 @@
+#include "rule_stats.hpp"
+#include "colors.hpp"
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    std::atomic<bool> enabled(false);
+
+    struct RuleTotals
+    {
+        std::atomic<uint64_t> calls;
+        std::atomic<uint64_t> nanoseconds;
+        std::atomic<uint64_t> assignments;
+        std::atomic<uint64_t> eliminations;
+    };
+
+    RuleTotals totals[num_logic_rules];
+}
+
+void rule_stats::enable()
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+bool rule_stats::is_enabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void rule_stats::record(LogicRule rule, std::chrono::nanoseconds time, int assignments, int eliminations)
+{
+    RuleTotals &rule_totals = totals[int(rule)];
+    rule_totals.calls.fetch_add(1, std::memory_order_relaxed);
+    rule_totals.nanoseconds.fetch_add(time.count(), std::memory_order_relaxed);
+    rule_totals.assignments.fetch_add(assignments, std::memory_order_relaxed);
+    rule_totals.eliminations.fetch_add(eliminations, std::memory_order_relaxed);
+}
+
+void rule_stats::print_report()
+{
+    uint64_t any_calls = 0;
+    for (const RuleTotals &rule_totals : totals)
+    {
+        any_calls += rule_totals.calls.load();
+    }
+    if (any_calls == 0)
+    {
+        std::cout << Color::teal << "No logic rules were applied." << Color::endl;
+        return;
+    }
+
+    const int name_width = 10;
+    const int value_width = 14;
+    std::cout << Color::green << "Logic rules:" << Color::endl
+              << std::setw(name_width) << std::left << "rule" << std::right
+              << std::setw(value_width) << "calls"
+              << std::setw(value_width) << "time (ms)"
+              << std::setw(value_width) << "assignments"
+              << std::setw(value_width) << "eliminations"
+              << std::setw(value_width) << "ns/change" << '\n';
+    for (int r = 0; r < num_logic_rules; r++)
+    {
+        const RuleTotals &rule_totals = totals[r];
+        uint64_t calls = rule_totals.calls.load();
+        if (calls == 0)
+        {
+            continue;
+        }
+        uint64_t nanoseconds = rule_totals.nanoseconds.load();
+        uint64_t changes = rule_totals.assignments.load() + rule_totals.eliminations.load();
+        std::cout << std::setw(name_width) << std::left << get_logic_rule_name(LogicRule(r)) << std::right
+                  << std::setw(value_width) << calls
+                  << std::setw(value_width) << std::fixed << std::setprecision(2) << nanoseconds / 1e6
+                  << std::setw(value_width) << rule_totals.assignments.load()
+                  << std::setw(value_width) << rule_totals.eliminations.load();
+        if (changes > 0)
+        {
+            std::cout << std::setw(value_width) << std::setprecision(1) << double(nanoseconds) / changes;
+        }
+        else
+        {
+            std::cout << std::setw(value_width) << "-";
+        }
+        std::cout << std::defaultfloat << '\n';
+    }
+    std::cout << std::flush;
+}
@@ -0,0 +1,344 @@
+#include "store.hpp"
+#include "colors.hpp"
+#include "transposition.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char magic[8] = {'S', 'U', 'D', 'O', 'K', 'U', 'S', 'T'};
+    const uint32_t version = 2;
+    const int board_size = Puzzle::gridSize * Puzzle::gridSize;
+    const int slot_words = sizeof(SolutionStore::Slot) / sizeof(uint64_t);
+
+    void pack(const char *board, uint8_t *packed)
+    {
+        memset(packed, 0, SolutionStore::packed_size);
+        for (int cell = 0; cell < board_size; cell++)
+        {
+            packed[cell / 2] |= (board[cell] - '0') << (cell % 2 * 4);
+        }
+    }
+
+    void unpack(const uint8_t *packed, char *board)
+    {
+        for (int cell = 0; cell < board_size; cell++)
+        {
+            board[cell] = '0' + ((packed[cell / 2] >> (cell % 2 * 4)) & 0xF);
+        }
+    }
+
+    // the Zobrist hash of the puzzle, the same one the search keeps for its boards.
+    uint64_t hash_puzzle(const char *puzzle)
+    {
+        uint64_t hash = 0;
+        for (int cell = 0; cell < board_size; cell++)
+        {
+            if (puzzle[cell] != '0')
+            {
+                hash ^= zobrist::keys.keys[cell][puzzle[cell] - '1'];
+            }
+        }
+        return hash;
+    }
+
+    std::atomic_ref<uint64_t> sequence_of(SolutionStore::Slot &slot)
+    {
+        return std::atomic_ref<uint64_t>(slot.sequence);
+    }
+
+    /**
+     * Copies a slot word by word with relaxed atomic loads, so that a concurrent writer is
+     * a race the sequence check catches rather than undefined behaviour.
+     */
+    void load_words(SolutionStore::Slot &slot, SolutionStore::Slot &copy)
+    {
+        uint64_t *from = reinterpret_cast<uint64_t *>(&slot);
+        uint64_t words[slot_words];
+        for (int w = 0; w < slot_words; w++)
+        {
+            words[w] = std::atomic_ref<uint64_t>(from[w]).load(std::memory_order_relaxed);
+        }
+        memcpy(&copy, words, sizeof(words));
+    }
+
+    // Stores every word of a slot after the first, which holds the sequence.
+    void store_words(const SolutionStore::Slot &value, SolutionStore::Slot &slot)
+    {
+        uint64_t words[slot_words];
+        memcpy(words, &value, sizeof(words));
+        uint64_t *to = reinterpret_cast<uint64_t *>(&slot);
+        for (int w = 1; w < slot_words; w++)
+        {
+            std::atomic_ref<uint64_t>(to[w]).store(words[w], std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Reads a consistent copy of a slot. Returns false if the writer kept rewriting it.
+     */
+    bool read_slot(SolutionStore::Slot &slot, SolutionStore::Slot &copy)
+    {
+        for (int attempt = 0; attempt < 64; attempt++)
+        {
+            uint64_t before = sequence_of(slot).load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                continue;
+            }
+            load_words(slot, copy);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_of(slot).load(std::memory_order_relaxed) == before)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Rewrites a slot under its sequence lock. Only the writer process calls it, holding its
+     * write mutex. A writer that was killed mid-write leaves an odd sequence in the file, so
+     * the sequence is first rounded up to even, and the slot is readable again afterwards.
+     */
+    void write_slot(const SolutionStore::Slot &value, SolutionStore::Slot &slot)
+    {
+        uint64_t sequence = (sequence_of(slot).load(std::memory_order_relaxed) + 1) & ~1ULL;
+        sequence_of(slot).store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store_words(value, slot);
+        sequence_of(slot).store(sequence + 2, std::memory_order_release);
+    }
+
+    std::atomic<uint64_t> num_hits(0);
+    std::atomic<uint64_t> num_misses(0);
+    std::atomic<uint64_t> num_inserts(0);
+    std::atomic<uint64_t> num_evictions(0);
+}
+
+SolutionStore::~SolutionStore()
+{
+    if (m_mapping)
+    {
+        munmap(m_mapping, m_size);
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+void SolutionStore::configure(const std::string &path, long long megabytes)
+{
+    m_path = path;
+    m_megabytes = megabytes;
+}
+
+void SolutionStore::open()
+{
+    m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT, 0644);
+    bool writer = m_fd >= 0 && flock(m_fd, LOCK_EX | LOCK_NB) == 0;
+    if (m_fd < 0)
+    {
+        m_fd = ::open(m_path.c_str(), O_RDONLY);
+    }
+    if (m_fd < 0 || !map_file(writer))
+    {
+        std::cout << Color::red << "Could not open solution store: " << Color::purple << m_path
+                  << Color::red << ", solving without it." << Color::endl;
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+        return;
+    }
+    if (!writer)
+    {
+        std::cout << Color::teal << "The solution store is being written by another process, only reading from it."
+                  << Color::endl;
+    }
+}
+
+bool SolutionStore::map_file(bool writer)
+{
+    struct stat st;
+    if (fstat(m_fd, &st) != 0)
+    {
+        return false;
+    }
+    size_t size = st.st_size;
+    bool created = writer && size == 0;
+    uint64_t slot_count = 1;
+    if (created)
+    {
+        // the largest power of two slots that fits in the size limit, plus the header.
+        size_t limit = size_t(std::max(m_megabytes, 1LL)) << 20;
+        while (slot_count * 2 * sizeof(Slot) <= limit)
+        {
+            slot_count *= 2;
+        }
+        size = sizeof(Header) + slot_count * sizeof(Slot);
+        if (ftruncate(m_fd, size) != 0)
+        {
+            return false;
+        }
+    }
+    if (size < sizeof(Header))
+    {
+        return false;
+    }
+    void *mapping = mmap(nullptr, size, writer ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    m_mapping = static_cast<char *>(mapping);
+    m_size = size;
+    m_header = reinterpret_cast<Header *>(m_mapping);
+    if (created)
+    {
+        m_header->version = version;
+        m_header->slot_size = sizeof(Slot);
+        m_header->slot_count = slot_count;
+        memcpy(m_header->magic, magic, sizeof(magic));
+    }
+
+    slot_count = m_header->slot_count;
+    if (memcmp(m_header->magic, magic, sizeof(magic)) != 0 || m_header->version != version ||
+        m_header->slot_size != sizeof(Slot) || slot_count == 0 || (slot_count & (slot_count - 1)) != 0 ||
+        size < sizeof(Header) + slot_count * sizeof(Slot))
+    {
+        munmap(m_mapping, m_size);
+        m_mapping = nullptr;
+        return false;
+    }
+    m_slots = reinterpret_cast<Slot *>(m_mapping + sizeof(Header));
+    m_index_mask = slot_count - 1;
+    m_writer = writer;
+    if (writer)
+    {
+        m_generation = std::atomic_ref<uint32_t>(m_header->generation).fetch_add(1) + 1;
+    }
+    return true;
+}
+
+bool SolutionStore::lookup(const char *puzzle, Entry &entry)
+{
+    std::call_once(m_opened, &SolutionStore::open, this);
+    if (!m_slots)
+    {
+        return false;
+    }
+    uint8_t packed[packed_size];
+    pack(puzzle, packed);
+    uint64_t hash = hash_puzzle(puzzle);
+
+    Slot copy;
+    for (int probe = 0; probe < max_probes; probe++)
+    {
+        Slot &slot = m_slots[(hash + probe) & m_index_mask];
+        if (!read_slot(slot, copy) || copy.last_used == 0)
+        {
+            // entries are never removed, only replaced, so the puzzle is not past an empty slot.
+            break;
+        }
+        if (copy.hash != hash || memcmp(copy.puzzle, packed, packed_size) != 0)
+        {
+            continue;
+        }
+        if (m_writer && copy.last_used != m_generation)
+        {
+            // marking the entry as used is a write like an insert, so that readers never see
+            // a slot half rewritten.
+            std::lock_guard<std::mutex> lock(m_write_mutex);
+            Slot current;
+            load_words(slot, current);
+            if (current.hash == hash && memcmp(current.puzzle, packed, packed_size) == 0)
+            {
+                current.last_used = m_generation;
+                write_slot(current, slot);
+            }
+        }
+        entry.status = SolveStatus(copy.status);
+        entry.guesses = copy.guesses;
+        entry.microseconds = copy.microseconds;
+        unpack(copy.board, entry.board);
+        num_hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    num_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SolutionStore::insert(const char *puzzle, const Entry &entry)
+{
+    std::call_once(m_opened, &SolutionStore::open, this);
+    if (!m_writer)
+    {
+        return;
+    }
+    Slot value = {};
+    value.last_used = m_generation;
+    value.guesses = entry.guesses;
+    value.microseconds = entry.microseconds;
+    value.hash = hash_puzzle(puzzle);
+    value.status = uint8_t(entry.status);
+    pack(puzzle, value.puzzle);
+    pack(entry.board, value.board);
+
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    Slot *target = nullptr;
+    Slot target_copy;
+    for (int probe = 0; probe < max_probes; probe++)
+    {
+        Slot &slot = m_slots[(value.hash + probe) & m_index_mask];
+        // only this thread changes slots now, so the copy is consistent.
+        Slot copy;
+        load_words(slot, copy);
+        bool same_puzzle = copy.hash == value.hash && memcmp(copy.puzzle, value.puzzle, packed_size) == 0;
+        // evict the least recently used entry, and of those, the cheapest one to solve again.
+        if (copy.last_used == 0 || same_puzzle || !target || copy.last_used < target_copy.last_used ||
+            (copy.last_used == target_copy.last_used && copy.microseconds < target_copy.microseconds))
+        {
+            target = &slot;
+            target_copy = copy;
+        }
+        if (copy.last_used == 0 || same_puzzle)
+        {
+            break;
+        }
+        if (probe == max_probes - 1)
+        {
+            num_evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    write_slot(value, *target);
+    num_inserts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SolutionStore::print_report()
+{
+    std::cout << Color::teal << "Solution store: "
+              << Color::yellow << num_hits.load()
+              << Color::teal << " hits, "
+              << Color::yellow << num_misses.load()
+              << Color::teal << " misses, "
+              << Color::yellow << num_inserts.load()
+              << Color::teal << " inserts, "
+              << Color::yellow << num_evictions.load()
+              << Color::teal << " evictions." << Color::endl;
+}
+
+SolutionStore &get_solution_store()
+{
+    static SolutionStore store;
+    return store;
+}
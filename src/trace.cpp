@@ -0,0 +1,185 @@
+#include "trace.hpp"
+#include "colors.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    std::atomic<bool> enabled(false);
+    std::string trace_path;
+    const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+    const char *span_names[] = {"read", "validate", "logic", "backtracking", "write"};
+
+    struct Event
+    {
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        long long puzzle;
+        trace::Span span;
+    };
+
+    /**
+     * One thread's spans. Only the owning thread writes to it, write_file() reads it
+     * once the recording threads are done.
+     */
+    struct ThreadBuffer
+    {
+        int thread_id;
+        long long puzzle = -1;
+        size_t num_recorded = 0;
+        std::vector<Event> events;
+    };
+
+    // Buffers of all threads that recorded something. A thread that exits puts its buffer on
+    // free_buffers, and the next new thread continues recording into it, so there are only as
+    // many buffers as threads recorded at the same time, and the spans of exited threads are
+    // kept until they are overwritten.
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> registry;
+    std::vector<ThreadBuffer *> free_buffers;
+
+    // Gives the buffer back to free_buffers when its thread exits.
+    struct BufferOwner
+    {
+        ThreadBuffer *buffer = nullptr;
+
+        ~BufferOwner()
+        {
+            if (buffer)
+            {
+                std::lock_guard<std::mutex> lock(registry_mutex);
+                free_buffers.push_back(buffer);
+            }
+        }
+    };
+
+    ThreadBuffer &get_thread_buffer()
+    {
+        thread_local BufferOwner owner;
+        if (!owner.buffer)
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            if (!free_buffers.empty())
+            {
+                owner.buffer = free_buffers.back();
+                free_buffers.pop_back();
+                owner.buffer->puzzle = -1;
+            }
+            else
+            {
+                registry.push_back(std::make_unique<ThreadBuffer>());
+                owner.buffer = registry.back().get();
+                owner.buffer->thread_id = registry.size();
+                owner.buffer->events.resize(trace::ring_capacity);
+            }
+        }
+        return *owner.buffer;
+    }
+
+    uint64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+    }
+}
+
+void trace::enable(const std::string &path)
+{
+    trace_path = path;
+    enabled = true;
+}
+
+bool trace::is_enabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void trace::set_puzzle(long long index)
+{
+    if (is_enabled())
+    {
+        get_thread_buffer().puzzle = index;
+    }
+}
+
+trace::Scope::Scope(Span span) : m_span(span), m_active(is_enabled())
+{
+    if (m_active)
+    {
+        m_start_ns = now_ns();
+    }
+}
+
+trace::Scope::~Scope()
+{
+    if (!m_active)
+    {
+        return;
+    }
+    ThreadBuffer &buffer = get_thread_buffer();
+    buffer.events[buffer.num_recorded++ % ring_capacity] = {m_start_ns, now_ns() - m_start_ns, buffer.puzzle, m_span};
+}
+
+/**
+ * Writes complete ("X") events with microsecond timestamps, and the name of every thread.
+ */
+bool trace::write_file(const std::string &suffix)
+{
+    std::string path = trace_path + suffix;
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << path << Color::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int pid = getpid();
+    size_t num_written = 0;
+    size_t num_dropped = 0;
+    const char *separator = "\n";
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::fixed << std::setprecision(3);
+    for (auto &buffer : registry)
+    {
+        out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+            << ",\"tid\":" << buffer->thread_id
+            << ",\"args\":{\"name\":\"thread " << buffer->thread_id << "\"}}";
+        separator = ",\n";
+
+        size_t first = buffer->num_recorded > ring_capacity ? buffer->num_recorded - ring_capacity : 0;
+        num_dropped += first;
+        for (size_t i = first; i < buffer->num_recorded; i++)
+        {
+            const Event &event = buffer->events[i % ring_capacity];
+            out << separator << "{\"name\":\"" << span_names[int(event.span)]
+                << "\",\"ph\":\"X\",\"pid\":" << pid
+                << ",\"tid\":" << buffer->thread_id
+                << ",\"ts\":" << event.start_ns / 1000.0
+                << ",\"dur\":" << event.duration_ns / 1000.0
+                << ",\"args\":{\"puzzle\":" << event.puzzle << "}}";
+            num_written++;
+        }
+    }
+    out << "\n]}\n";
+    if (!out.flush())
+    {
+        std::cout << Color::red << "Could not write file: " << Color::purple << path << Color::endl;
+        return false;
+    }
+
+    std::cout << Color::teal << "Wrote " << Color::yellow << num_written << Color::teal << " spans to "
+              << Color::purple << path << Color::teal;
+    if (num_dropped)
+    {
+        std::cout << " (" << Color::yellow << num_dropped << Color::teal << " older spans were overwritten)";
+    }
+    std::cout << "." << Color::endl;
+    return true;
+}
@@ -0,0 +1,26 @@
+#include "transposition.hpp"
+#include <algorithm>
+
+void TranspositionTable::resize(long long megabytes)
+{
+    size_t num_slots = 0;
+    if (megabytes > 0)
+    {
+        num_slots = 1;
+        while (num_slots * 2 * sizeof(uint64_t) <= size_t(megabytes) << 20)
+        {
+            num_slots *= 2;
+        }
+    }
+    if (num_slots == m_slots.size())
+    {
+        return;
+    }
+    std::vector<uint64_t>(num_slots, 0).swap(m_slots);
+    m_index_mask = num_slots ? num_slots - 1 : 0;
+}
+
+void TranspositionTable::clear()
+{
+    std::fill(m_slots.begin(), m_slots.end(), 0);
+}
@@ -0,0 +1,202 @@
+#include "verify.hpp"
+#include "batch.hpp"
+#include "bitops.hpp"
+#include "colors.hpp"
+#include "process_args.hpp"
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const char *get_grid_check_name(GridCheck check)
+{
+    switch (check)
+    {
+    case GridCheck::valid:
+        return "valid";
+    case GridCheck::malformed:
+        return "malformed";
+    case GridCheck::illegal:
+        return "illegal";
+    case GridCheck::clues_changed:
+        return "clues_changed";
+    case GridCheck::missing:
+        return "missing";
+    }
+    return "unknown";
+}
+
+/**
+ * With the cells of every digit as band masks, a grid of 81 digits is valid exactly when every
+ * digit occurs in all 9 rows, all 9 columns and all 9 boxes: 9 digits covering 9 rows each
+ * take all 81 cells, so none of them can occur twice in a zone. The checks are ORs and ANDs
+ * of whole bands, without a branch per zone.
+ */
+GridCheck check_grid(const char *grid, size_t length, const char *clues, size_t clues_length)
+{
+    if (length != 81)
+    {
+        return GridCheck::malformed;
+    }
+    uint32_t planes[9][3];
+    bitops::active->digit_planes(grid, planes);
+
+    // a cell matches at most one digit, so all cells are digits when the planes cover the bands.
+    uint32_t digit_cells[3] = {};
+    bool covered = true;
+    for (const auto &plane : planes)
+    {
+        uint32_t bands = plane[0] | plane[1] | plane[2];
+        uint32_t columns = (bands | (bands >> 9) | (bands >> 18)) & 0x1FF;
+        covered &= columns == 0x1FF;
+        for (int b = 0; b < 3; b++)
+        {
+            uint32_t band = plane[b];
+            uint32_t band_columns = band | (band >> 9) | (band >> 18);
+            digit_cells[b] |= band;
+            covered &= ((band & 0x1FF) != 0) & ((band & 0x3FE00) != 0) & ((band & 0x7FC0000) != 0) &
+                       ((band_columns & 0x7) != 0) & ((band_columns & 0x38) != 0) & ((band_columns & 0x1C0) != 0);
+        }
+    }
+    if ((digit_cells[0] & digit_cells[1] & digit_cells[2]) != 0x7FFFFFF)
+    {
+        return GridCheck::malformed;
+    }
+    if (!covered)
+    {
+        return GridCheck::illegal;
+    }
+
+    if (clues)
+    {
+        bool kept = clues_length == 81;
+        for (size_t i = 0; i < 81 && kept; i++)
+        {
+            kept = clues[i] == '0' || clues[i] == grid[i];
+        }
+        if (!kept)
+        {
+            return GridCheck::clues_changed;
+        }
+    }
+    return GridCheck::valid;
+}
+
+/**
+ * Cursor over the lines of a mapped file, without their line terminators.
+ */
+struct LineCursor
+{
+    const char *data;
+    size_t size;
+    size_t position = 0;
+
+    bool next(const char *&line, size_t &length)
+    {
+        if (position >= size)
+        {
+            return false;
+        }
+        const char *newline = static_cast<const char *>(memchr(data + position, '\n', size - position));
+        size_t end = newline ? newline - data : size;
+        line = data + position;
+        length = end - position;
+        if (length > 0 && line[length - 1] == '\r')
+        {
+            length--;
+        }
+        position = end + 1;
+        return true;
+    }
+};
+
+bool verify_file(const std::string &grids_path, const std::string &clues_path, const std::string &results_path)
+{
+    InputFile grids_file;
+    InputFile clues_file;
+    for (auto [file, path] : {std::pair(&grids_file, &grids_path), std::pair(&clues_file, &clues_path)})
+    {
+        if (!path->empty() && !file->open(*path))
+        {
+            std::cout << Color::red << "Could not open file: " << Color::purple << *path << Color::endl;
+            return false;
+        }
+    }
+    std::ofstream results;
+    if (!results_path.empty())
+    {
+        results.open(results_path, std::ios::binary | std::ios::trunc);
+        if (!results.is_open())
+        {
+            std::cout << Color::red << "Could not write file: " << Color::purple << results_path << Color::endl;
+            return false;
+        }
+    }
+
+    // results are formatted into a buffer that is written out in large blocks.
+    const size_t flush_size = 1 << 20;
+    std::string buffer;
+    buffer.reserve(flush_size + 64);
+
+    LineCursor grids{grids_file.data(), grids_file.size()};
+    LineCursor clues{clues_file.data(), clues_file.size()};
+    const char *grid = nullptr;
+    const char *clue = nullptr;
+    size_t grid_length = 0;
+    size_t clue_length = 0;
+    long long counts[int(GridCheck::missing) + 1] = {};
+    long long total = 0;
+    for (long long line_number = 1;; line_number++)
+    {
+        bool has_grid = grids.next(grid, grid_length);
+        bool has_clue = !clues_path.empty() && clues.next(clue, clue_length);
+        if (!has_grid && !has_clue)
+        {
+            break;
+        }
+        if (has_grid && grid_length == 0 && (!has_clue || clue_length == 0))
+        {
+            continue;
+        }
+
+        GridCheck check = has_grid ? check_grid(grid, grid_length, has_clue ? clue : nullptr, clue_length)
+                                   : GridCheck::missing;
+        counts[int(check)]++;
+        total++;
+        if (results.is_open())
+        {
+            char number[24];
+            char *end = std::to_chars(number, number + sizeof(number), line_number).ptr;
+            buffer.append(number, end - number).append(1, ' ').append(get_grid_check_name(check)).append(1, '\n');
+            if (buffer.size() >= flush_size)
+            {
+                results.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+        else if (check != GridCheck::valid)
+        {
+            std::cout << Color::red << "Line " << line_number << ": " << get_grid_check_name(check) << Color::endl;
+        }
+        if (cancel_requested)
+        {
+            break;
+        }
+    }
+    results.write(buffer.data(), buffer.size());
+
+    std::cout << Color::green << "Verified "
+              << Color::yellow << total
+              << Color::green << " grids: "
+              << Color::yellow << counts[int(GridCheck::valid)]
+              << Color::green << " valid";
+    for (GridCheck check : {GridCheck::malformed, GridCheck::illegal, GridCheck::clues_changed, GridCheck::missing})
+    {
+        if (counts[int(check)])
+        {
+            std::cout << ", " << Color::yellow << counts[int(check)] << Color::green << " " << get_grid_check_name(check);
+        }
+    }
+    std::cout << "." << Color::endl;
+    return !results.is_open() || bool(results.flush());
+}
@@ -0,0 +1,134 @@
+#include "batch.hpp"
+#include "puzzle.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * Checks that a batch run does no steady-state heap allocation: after a first pass over
+ * the puzzles has warmed up the solver context, a second pass must not allocate at all,
+ * also when hard puzzles are raced by a portfolio (whose member threads the first pass
+ * starts). A threaded --records run allocates per run and per thread, but not per puzzle:
+ * a run over copies_per_run copies of the puzzles may only allocate more to grow its
+ * index of the lines, which doubles its capacity when it is full.
+ *
+ * usage: alloc_test puzzle_file work_directory
+ */
+
+const int copies_per_run = 8;
+const int record_threads = 4;
+
+std::atomic<long long> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+/**
+ * Discards everything written to it, without buffering.
+ */
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+};
+
+// Solves every puzzle twice with process_puzzle, and returns the allocations of the second pass.
+long long count_steady_state_allocations(const std::vector<std::string> &lines, const SearchStrategy &strategy)
+{
+    long long counts[2];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        long long before = allocations;
+        int count = 0;
+        for (const std::string &line : lines)
+        {
+            process_puzzle(line, ++count, SearchLimits(), strategy);
+        }
+        counts[pass] = allocations - before;
+    }
+    return counts[1];
+}
+
+// The allocations of a threaded --records run over copies copies of the puzzles.
+long long count_records_allocations(const std::vector<std::string> &lines, int copies, const std::string &directory)
+{
+    std::string input_path = directory + "/alloc_test_input.txt";
+    {
+        std::ofstream input(input_path, std::ios::trunc);
+        for (int copy = 0; copy < copies; copy++)
+        {
+            for (const std::string &line : lines)
+            {
+                input << line << '\n';
+            }
+        }
+    }
+    long long before = allocations;
+    process_file_records(input_path, directory + "/alloc_test.records", record_threads, 0, 1, SearchLimits(),
+                         SearchStrategy(), Journal());
+    return allocations - before;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: alloc_test puzzle_file work_directory" << std::endl;
+        return 2;
+    }
+    std::vector<std::string> lines;
+    std::ifstream infile(argv[1]);
+    for (std::string line; getline(infile, line);)
+    {
+        lines.push_back(line);
+    }
+
+    NullBuffer null_buffer;
+    std::streambuf *cout_buffer = std::cout.rdbuf(&null_buffer);
+
+    long long steady_state = count_steady_state_allocations(lines, SearchStrategy());
+    SearchStrategy portfolio_strategy;
+    portfolio_strategy.portfolio_threads = 2;
+    portfolio_strategy.portfolio_budget = 16;
+    long long portfolio = count_steady_state_allocations(lines, portfolio_strategy);
+
+    count_records_allocations(lines, 1, argv[2]);
+    long long single_run = count_records_allocations(lines, 1, argv[2]);
+    long long copies_run = count_records_allocations(lines, copies_per_run, argv[2]);
+    // growing from the capacity of one copy to that of copies_per_run copies.
+    long long index_growth = 1;
+    for (int copies = 1; copies < copies_per_run; copies *= 2)
+    {
+        index_growth++;
+    }
+
+    std::cout.rdbuf(cout_buffer);
+    std::cout << "allocations: steady-state pass " << steady_state << ", with a portfolio " << portfolio
+              << ", records run " << single_run << ", over " << copies_per_run << " copies " << copies_run
+              << std::endl;
+    return steady_state == 0 && portfolio == 0 && copies_run - single_run <= index_growth ? 0 : 1;
+}
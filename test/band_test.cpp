@@ -0,0 +1,99 @@
+#include "puzzle.hpp"
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+/**
+ * Checks the band engine against the classic one, on the corpus puzzles and on random
+ * variants of them with clues added (often impossible) or removed (often several solutions).
+ * Both engines must agree on the status, and a solved board must be complete, legal and
+ * keep all clues. Where the puzzle has a unique solution, the boards must be equal.
+ *
+ * usage: band_test corpus_file
+ */
+
+const int variants_per_puzzle = 20;
+
+SolveStatus solve_with(Engine engine, const std::string &clues, std::string &board)
+{
+    SearchStrategy strategy;
+    strategy.engine = engine;
+    Puzzle puzzle(clues);
+    puzzle.set_strategy(strategy);
+    SolveStatus status = puzzle.solve();
+    board = puzzle.get_puzzle_string();
+    if (status == SolveStatus::solved && !puzzle.is_legal())
+    {
+        status = SolveStatus::illegal;
+    }
+    return status;
+}
+
+bool keeps_clues(const std::string &board, const std::string &clues)
+{
+    for (size_t i = 0; i < clues.size(); i++)
+    {
+        if (clues[i] != '0' && clues[i] != board[i])
+        {
+            return false;
+        }
+    }
+    return board.find('0') == std::string::npos;
+}
+
+/**
+ * Compares the engines on one puzzle. The solution is only known for the corpus puzzles.
+ */
+bool engines_agree(const std::string &clues, const std::string &solution)
+{
+    std::string classic_board;
+    std::string band_board;
+    SolveStatus classic = solve_with(Engine::classic, clues, classic_board);
+    SolveStatus band = solve_with(Engine::band, clues, band_board);
+    bool agree = classic == band;
+    if (agree && band == SolveStatus::solved)
+    {
+        agree = keeps_clues(band_board, clues) && (solution.empty() || band_board == solution);
+    }
+    if (!agree)
+    {
+        std::cout << clues << ": classic " << get_status_name(classic) << " " << classic_board
+                  << ", band " << get_status_name(band) << " " << band_board << std::endl;
+    }
+    return agree;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: band_test corpus_file" << std::endl;
+        return 2;
+    }
+
+    std::mt19937 rng(11);
+    std::ifstream infile(argv[1]);
+    int failures = 0;
+    int puzzles = 0;
+    for (std::string clues, solution; infile >> clues >> solution;)
+    {
+        failures += !engines_agree(clues, solution);
+        puzzles++;
+        for (int v = 0; v < variants_per_puzzle; v++)
+        {
+            std::string variant = clues;
+            int cell = rng() % 81;
+            variant[cell] = variant[cell] == '0' ? char('1' + rng() % 9) : '0';
+            if (!Puzzle(variant).is_legal())
+            {
+                continue;
+            }
+            failures += !engines_agree(variant, "");
+            puzzles++;
+        }
+    }
+
+    std::cout << puzzles << " puzzles, " << failures << " disagreements" << std::endl;
+    return failures || puzzles == 0 ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#include "bitops.hpp"
+#include <cstring>
+#include <iostream>
+#include <random>
+
+/**
+ * Checks the scalar helpers against bit-by-bit loops, and every kernel build the CPU supports
+ * against the generic one.
+ */
+int main()
+{
+    int failures = 0;
+    for (uint32_t mask = 0; mask < (1 << 9); mask++)
+    {
+        int count = 0;
+        int highest = -1;
+        int lowest = -1;
+        for (int bit = 0; bit < 9; bit++)
+        {
+            if (mask & (1 << bit))
+            {
+                failures += bitops::select_bit(mask, count) != bit;
+                count++;
+                highest = bit;
+                lowest = lowest < 0 ? bit : lowest;
+            }
+        }
+        failures += bitops::popcount(mask) != count;
+        failures += bitops::highest_bit(mask) != highest;
+        failures += bitops::lowest_bit(mask) != lowest;
+        failures += bitops::clear_lowest_bit(mask) != (lowest < 0 ? 0 : mask & ~(1U << lowest));
+    }
+    std::cout << "scalar helpers: " << (failures ? "FAILED" : "ok") << std::endl;
+
+    const char *names[] = {"generic", "bmi2", "avx2"};
+    bitops::select("generic");
+    bitops::Kernels reference = *bitops::active;
+    for (const char *name : names)
+    {
+        if (!bitops::select(name))
+        {
+            std::cout << name << ": not supported, skipped" << std::endl;
+            continue;
+        }
+        const bitops::Kernels *kernels = bitops::active;
+        std::mt19937 rng(1);
+        for (int round = 0; round < 10000; round++)
+        {
+            uint16_t cells[9];
+            uint16_t expected[9];
+            uint16_t actual[9];
+            for (auto &cell : cells)
+            {
+                cell = rng() & 0x1FF;
+            }
+            reference.transpose_unit(cells, expected);
+            kernels->transpose_unit(cells, actual);
+            for (int s = 0; s < 9; s++)
+            {
+                failures += expected[s] != actual[s];
+            }
+        }
+
+        // grids of mostly digits, with some other characters around them.
+        for (int round = 0; round < 10000; round++)
+        {
+            char grid[81];
+            uint32_t expected[9][3];
+            uint32_t actual[9][3];
+            for (char &c : grid)
+            {
+                c = char('0' + rng() % 11);
+            }
+            reference.digit_planes(grid, expected);
+            kernels->digit_planes(grid, actual);
+            failures += memcmp(expected, actual, sizeof(expected)) != 0;
+        }
+        std::cout << name << ": " << (failures ? "FAILED" : "ok") << std::endl;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,31 @@
+# Checks that the builds of the hot functions for CPUs with POPCNT (see BITOPS_CLONES in
+# bitops.hpp) count bits with the popcnt instruction, rather than calling libgcc.
+#
+# usage: cmake -DOBJDUMP=objdump -DLIBRARY=libsudoku_core.a -P check_popcnt.cmake
+
+execute_process(COMMAND ${OBJDUMP} -d --no-show-raw-insn -C ${LIBRARY}
+                OUTPUT_VARIABLE disassembly
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Could not disassemble ${LIBRARY}")
+endif()
+
+# every function is a "<name>:" line followed by its instructions, up to an empty line.
+string(REGEX MATCHALL "<[^\n]*\\[clone \\.(popcnt|arch_x86_64_v3)\\]>:\n[^\n]+(\n[^\n]+)*" builds "${disassembly}")
+list(LENGTH builds num_builds)
+if(num_builds EQUAL 0)
+    message(FATAL_ERROR "No POPCNT builds of the hot functions in ${LIBRARY}")
+endif()
+
+set(failures 0)
+foreach(build IN LISTS builds)
+    string(REGEX MATCH "^<[^\n]*>" name "${build}")
+    if(NOT build MATCHES "\tpopcnt " OR build MATCHES "__popcount")
+        message("No popcnt instruction in ${name}")
+        math(EXPR failures "${failures} + 1")
+    endif()
+endforeach()
+if(failures GREATER 0)
+    message(FATAL_ERROR "${failures} of ${num_builds} POPCNT builds do not use popcnt")
+endif()
+message("All ${num_builds} POPCNT builds use popcnt")
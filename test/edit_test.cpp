@@ -0,0 +1,93 @@
+#include "puzzle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+/**
+ * Applies random clue edits to solved puzzles, and checks every edit_clue() result:
+ * a solved board must be complete, legal and keep all clues, and an impossible
+ * puzzle must also be impossible when solved from scratch. The logic assignments counted for
+ * an edit can be no more than the cells the clues leave open.
+ *
+ * usage: edit_test corpus_file
+ */
+
+const int edits_per_puzzle = 20;
+
+bool keeps_clues(const std::string &board, const std::string &clues)
+{
+    for (size_t i = 0; i < clues.size(); i++)
+    {
+        if (clues[i] != '0' && clues[i] != board[i])
+        {
+            return false;
+        }
+    }
+    return board.find('0') == std::string::npos;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: edit_test corpus_file" << std::endl;
+        return 2;
+    }
+    SearchLimits limits;
+    limits.max_guesses = 1000000;
+
+    std::mt19937 rng(7);
+    std::ifstream infile(argv[1]);
+    int failures = 0;
+    int edits = 0;
+    std::chrono::nanoseconds edit_time(0);
+    for (std::string clues, solution; infile >> clues >> solution;)
+    {
+        Puzzle puzzle(clues);
+        puzzle.set_limits(limits);
+        puzzle.solve();
+        for (int e = 0; e < edits_per_puzzle; e++)
+        {
+            int cell = rng() % 81;
+            char symbol = (clues[cell] != '0' && rng() % 2) ? '0' : char('1' + rng() % 9);
+            clues[cell] = symbol;
+
+            auto start = std::chrono::steady_clock::now();
+            SolveStatus status = puzzle.edit_clue(cell / 9, cell % 9, symbol);
+            edit_time += std::chrono::steady_clock::now() - start;
+            edits++;
+
+            if (status == SolveStatus::solved && !(keeps_clues(puzzle.get_puzzle_string(), clues) && puzzle.is_legal()))
+            {
+                std::cout << "Bad solution after edit: " << clues << std::endl;
+                failures++;
+            }
+            long open_cells = std::count(clues.begin(), clues.end(), '0');
+            if (puzzle.get_num_logic_assignments() > open_cells)
+            {
+                std::cout << "Logic assignments carried over from an earlier edit: " << clues << std::endl;
+                failures++;
+            }
+            if (status == SolveStatus::impossible)
+            {
+                Puzzle fresh(clues);
+                fresh.set_limits(limits);
+                if (fresh.is_legal() && fresh.solve() == SolveStatus::solved)
+                {
+                    std::cout << "Edit reported impossible, but puzzle is solvable: " << clues << std::endl;
+                    failures++;
+                }
+                // undo the edit, so that the following edits work on a solvable puzzle.
+                clues[cell] = '0';
+                puzzle.edit_clue(cell / 9, cell % 9, '0');
+            }
+        }
+    }
+    std::cout << edits << " edits, "
+              << std::chrono::duration<double, std::micro>(edit_time).count() / edits
+              << " us per edit" << std::endl;
+    return failures ? 1 : 0;
+}
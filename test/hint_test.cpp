@@ -0,0 +1,106 @@
+#include "hint.hpp"
+#include "puzzle.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+/**
+ * Checks HintSession against the known solutions of a corpus: every hint must assign the
+ * solution's digit or keep it, following the hints must end on the same board as the logic
+ * phase of Puzzle, and the candidates kept up to date through placements must equal those
+ * of a session loaded from the resulting board.
+ *
+ * usage: hint_test corpus_file
+ */
+
+const int placements_per_puzzle = 20;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: hint_test corpus_file" << std::endl;
+        return 2;
+    }
+
+    std::mt19937 rng(7);
+    std::ifstream infile(argv[1]);
+    int failures = 0;
+    long long steps = 0;
+    std::chrono::nanoseconds step_time(0);
+    for (std::string clues, solution; infile >> clues >> solution;)
+    {
+        HintSession session;
+        if (!session.load(clues.c_str(), clues.size()))
+        {
+            std::cout << "Could not load: " << clues << std::endl;
+            failures++;
+            continue;
+        }
+
+        while (true)
+        {
+            Step step;
+            auto start = std::chrono::steady_clock::now();
+            bool found = session.next_step(step);
+            step_time += std::chrono::steady_clock::now() - start;
+            if (!found)
+            {
+                break;
+            }
+            steps++;
+            bool wrong = step.rule == StepRule::box_line ? false : solution[step.cell] != step.symbol;
+            for (int e = 0; e < step.num_eliminated; e++)
+            {
+                wrong |= solution[step.eliminated[e]] == step.symbol;
+            }
+            if (wrong)
+            {
+                std::cout << "Wrong " << get_step_rule_name(step.rule) << " for " << clues << std::endl;
+                failures++;
+                break;
+            }
+            session.apply(step);
+        }
+
+        Puzzle puzzle(clues);
+        puzzle.try_to_solve_logically();
+        if (puzzle.get_puzzle_string() != session.get_board())
+        {
+            std::cout << "Hints end on " << session.get_board() << ", the logic phase on "
+                      << puzzle.get_puzzle_string() << std::endl;
+            failures++;
+        }
+
+        // placements update the candidates the same way loading the board does.
+        HintSession placed;
+        placed.load(clues.c_str(), clues.size());
+        std::string board = clues;
+        for (int p = 0; p < placements_per_puzzle; p++)
+        {
+            int cell = rng() % 81;
+            if (board[cell] == '0')
+            {
+                placed.place(cell, solution[cell]);
+                board[cell] = solution[cell];
+            }
+        }
+        HintSession loaded;
+        loaded.load(board.c_str(), board.size());
+        for (int cell = 0; cell < 81; cell++)
+        {
+            if (placed.get_candidates(cell) != loaded.get_candidates(cell))
+            {
+                std::cout << "Candidates of cell " << cell << " differ after placements in " << clues << std::endl;
+                failures++;
+                break;
+            }
+        }
+    }
+    std::cout << steps << " steps, "
+              << std::chrono::duration<double, std::nano>(step_time).count() / std::max(steps, 1LL)
+              << " ns per next_step" << std::endl;
+    return failures ? 1 : 0;
+}
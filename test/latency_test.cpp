@@ -0,0 +1,45 @@
+#include "latency.hpp"
+#include <iostream>
+#include <algorithm>
+#include <random>
+
+/**
+ * Checks the histogram percentiles against the exact ones, on a heavy-tailed sample.
+ */
+int main()
+{
+    std::mt19937_64 rng(1);
+    std::lognormal_distribution<double> distribution(10, 2);
+    std::vector<uint64_t> values;
+    LatencyHistogram first_half;
+    LatencyHistogram second_half;
+    for (int i = 0; i < 100000; i++)
+    {
+        values.push_back(uint64_t(distribution(rng)));
+        (i % 2 ? first_half : second_half).record(values.back());
+    }
+    LatencyHistogram histogram;
+    histogram.merge(first_half);
+    histogram.merge(second_half);
+    std::sort(values.begin(), values.end());
+
+    int failures = 0;
+    if (histogram.count() != values.size() || histogram.max() != values.back())
+    {
+        std::cout << "count or max differ" << std::endl;
+        failures++;
+    }
+    for (double percentile : {0.1, 50.0, 90.0, 99.0, 99.9, 100.0})
+    {
+        uint64_t exact = values[std::max<size_t>(1, size_t(percentile / 100 * values.size() + 0.5)) - 1];
+        uint64_t value = histogram.value_at_percentile(percentile);
+        // the bucket limit is at or above the exact value, by at most the bucket width.
+        if (value < exact || value > exact + exact / LatencyHistogram::sub_bucket_count + 1)
+        {
+            std::cout << "p" << percentile << ": " << value << ", exact " << exact << std::endl;
+            failures++;
+        }
+    }
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
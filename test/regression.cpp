@@ -0,0 +1,294 @@
+#include "colors.hpp"
+#include "puzzle.hpp"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Correctness and performance regression check for a single corpus.
+ *
+ * usage: regression corpus_file baseline_file [--update]
+ *                   [--engine classic|band] [--branching first|mrv]
+ *                   [--value-order descending|lcv|random] [--seed N] [--restarts guesses]
+ *                   [--table-mb megabytes] [--rules singles,hidden,boxline|none]
+ *
+ * The corpus holds one "puzzle solution" pair per line. Every puzzle must solve to its
+ * known solution. The corpus is then solved repeatedly, for at least min_rounds passes and
+ * min_seconds of CPU time, each pass followed by as long a run of reference_solve(). The
+ * throughput of the fastest pass relative to that of the fastest reference run (so that it
+ * does not depend on the machine, or on the tests running next to this one, and passes that
+ * were slowed down by cache or memory contention do not count) and the average guesses per
+ * puzzle are compared against the baseline file. The test fails if either is worse than the baseline by more than the
+ * tolerance stored in the baseline file. --update re-records the baseline values.
+ */
+
+const double min_seconds = 0.25;
+const int min_rounds = 5;
+const double default_throughput_tolerance = 0.15;
+const double default_guesses_tolerance = 0.05;
+
+// Takes plain backtracking about a millisecond.
+const char reference_puzzle[] = "000020040008035000000070602031046970200000000000501203049000730000000010800004000";
+
+struct CorpusEntry
+{
+    std::string puzzle;
+    std::string solution;
+};
+
+std::vector<CorpusEntry> read_corpus(const std::string &filepath)
+{
+    std::vector<CorpusEntry> corpus;
+    std::ifstream infile(filepath);
+    for (CorpusEntry entry; infile >> entry.puzzle >> entry.solution;)
+    {
+        corpus.push_back(entry);
+    }
+    return corpus;
+}
+
+// The CPU time the calling thread has used.
+double get_cpu_seconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * Solves the board by trying the symbols of the first unassigned cell in order. It does not
+ * use the library, so that its speed only depends on the machine and its load.
+ */
+bool reference_solve(char *board, int cell = 0)
+{
+    while (cell < Puzzle::gridSize * Puzzle::gridSize && board[cell] != '0')
+    {
+        cell++;
+    }
+    if (cell == Puzzle::gridSize * Puzzle::gridSize)
+    {
+        return true;
+    }
+    int row = cell / 9;
+    int col = cell % 9;
+    for (char symbol = '1'; symbol <= '9'; symbol++)
+    {
+        bool allowed = true;
+        for (int k = 0; k < 9 && allowed; k++)
+        {
+            int box_cell = (row / 3 * 3 + k / 3) * 9 + col / 3 * 3 + k % 3;
+            allowed = board[row * 9 + k] != symbol && board[k * 9 + col] != symbol && board[box_cell] != symbol;
+        }
+        if (allowed)
+        {
+            board[cell] = symbol;
+            if (reference_solve(board, cell + 1))
+            {
+                return true;
+            }
+        }
+    }
+    board[cell] = '0';
+    return false;
+}
+
+/**
+ * Reads "key value" lines, ignoring lines that start with '#'.
+ */
+std::map<std::string, double> read_baseline(const std::string &filepath)
+{
+    std::map<std::string, double> baseline;
+    std::ifstream infile(filepath);
+    for (std::string line; getline(infile, line);)
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        size_t space = line.find(' ');
+        if (space != std::string::npos)
+        {
+            baseline[line.substr(0, space)] = std::stod(line.substr(space + 1));
+        }
+    }
+    return baseline;
+}
+
+void write_baseline(const std::string &filepath, const std::map<std::string, double> &baseline)
+{
+    std::ofstream outfile(filepath);
+    outfile << "# Written by `regression <corpus> <baseline> --update`. Tolerances are fractions." << '\n';
+    for (auto &entry : baseline)
+    {
+        outfile << entry.first << " " << entry.second << '\n';
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: regression corpus_file baseline_file [--update]" << std::endl;
+        return 2;
+    }
+    std::string corpus_path = argv[1];
+    std::string baseline_path = argv[2];
+    bool update = false;
+    SearchStrategy strategy;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--update")
+        {
+            update = true;
+        }
+        else if (arg == "--engine" && i + 1 < argc && parse_engine(argv[i + 1], strategy.engine))
+        {
+            i++;
+        }
+        else if (arg == "--branching" && i + 1 < argc && parse_branching(argv[i + 1], strategy.branching))
+        {
+            i++;
+        }
+        else if (arg == "--value-order" && i + 1 < argc && parse_value_order(argv[i + 1], strategy.value_order))
+        {
+            i++;
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            strategy.seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--restarts" && i + 1 < argc)
+        {
+            strategy.restart_unit = std::stoll(argv[++i]);
+        }
+        else if (arg == "--table-mb" && i + 1 < argc)
+        {
+            strategy.table_megabytes = std::stoll(argv[++i]);
+        }
+        else if (arg == "--rules" && i + 1 < argc && parse_logic_pipeline(argv[i + 1], strategy.rules))
+        {
+            i++;
+        }
+        else
+        {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<CorpusEntry> corpus = read_corpus(corpus_path);
+    if (corpus.empty())
+    {
+        std::cout << Color::red << "Empty or missing corpus: " << corpus_path << Color::endl;
+        return 1;
+    }
+
+    // each pass over the corpus starts with an empty table, so that passes measure the same work.
+    TranspositionTable table;
+    table.resize(strategy.table_megabytes);
+
+    // correctness
+    int failures = 0;
+    long long guesses = 0;
+    for (size_t i = 0; i < corpus.size(); i++)
+    {
+        Puzzle puzzle(corpus[i].puzzle);
+        puzzle.set_strategy(strategy);
+        puzzle.set_transposition_table(&table);
+        if (puzzle.solve() != SolveStatus::solved || puzzle.get_puzzle_string() != corpus[i].solution)
+        {
+            std::cout << Color::red << "Wrong solution for puzzle " << i + 1 << ": " << corpus[i].puzzle << Color::endl;
+            failures++;
+        }
+        guesses += puzzle.get_num_backtracking_guesses();
+    }
+    if (failures)
+    {
+        return 1;
+    }
+
+    // throughput in CPU time, so that time other processes run is not counted, alternating with
+    // the reference, so that both run at the same clock speed and share caches alike.
+    long long solved = 0;
+    double elapsed = 0;
+    int rounds = 0;
+    double best_pass_rate = 0;
+    double best_reference_rate = 0;
+    while (elapsed < min_seconds || rounds < min_rounds)
+    {
+        table.clear();
+        double start = get_cpu_seconds();
+        for (auto &entry : corpus)
+        {
+            Puzzle puzzle(entry.puzzle);
+            puzzle.set_strategy(strategy);
+            puzzle.set_transposition_table(&table);
+            solved += puzzle.solve() == SolveStatus::solved;
+        }
+        double end = get_cpu_seconds();
+        elapsed += end - start;
+
+        long long reference_solved = 0;
+        double reference_end = end;
+        while (reference_end - end < end - start)
+        {
+            std::string board = reference_puzzle;
+            reference_solved += reference_solve(board.data());
+            reference_end = get_cpu_seconds();
+        }
+        best_pass_rate = std::max(best_pass_rate, corpus.size() / (end - start));
+        best_reference_rate = std::max(best_reference_rate, reference_solved / (reference_end - end));
+        rounds++;
+    }
+
+    double puzzles_per_second = solved / elapsed;
+    double relative_throughput = best_pass_rate / best_reference_rate;
+    double guesses_per_puzzle = double(guesses) / corpus.size();
+
+    std::cout << corpus.size() << " puzzles, "
+              << puzzles_per_second << " puzzles/s, "
+              << relative_throughput << " times the reference, "
+              << guesses_per_puzzle << " guesses/puzzle" << std::endl;
+
+    std::map<std::string, double> baseline = read_baseline(baseline_path);
+    if (update)
+    {
+        baseline.erase("puzzles_per_second");
+        baseline["relative_throughput"] = relative_throughput;
+        baseline["guesses_per_puzzle"] = guesses_per_puzzle;
+        baseline.emplace("throughput_tolerance", default_throughput_tolerance);
+        baseline.emplace("guesses_tolerance", default_guesses_tolerance);
+        write_baseline(baseline_path, baseline);
+        std::cout << "Updated baseline " << baseline_path << std::endl;
+        return 0;
+    }
+    if (!baseline.count("relative_throughput") || !baseline.count("guesses_per_puzzle"))
+    {
+        std::cout << Color::red << "Missing baseline: " << baseline_path << Color::endl;
+        return 1;
+    }
+
+    double throughput_tolerance = baseline.count("throughput_tolerance") ? baseline["throughput_tolerance"] : default_throughput_tolerance;
+    double guesses_tolerance = baseline.count("guesses_tolerance") ? baseline["guesses_tolerance"] : default_guesses_tolerance;
+    double min_throughput = baseline["relative_throughput"] * (1 - throughput_tolerance);
+    double max_guesses = baseline["guesses_per_puzzle"] * (1 + guesses_tolerance);
+
+    if (relative_throughput < min_throughput)
+    {
+        std::cout << Color::red << "Throughput regressed: " << relative_throughput
+                  << " times the reference, baseline allows no less than " << min_throughput << Color::endl;
+        failures++;
+    }
+    if (guesses_per_puzzle > max_guesses)
+    {
+        std::cout << Color::red << "Guesses regressed: " << guesses_per_puzzle
+                  << " guesses/puzzle, baseline allows no more than " << max_guesses << Color::endl;
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
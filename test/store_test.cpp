@@ -0,0 +1,88 @@
+#include "store.hpp"
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Checks that the solution store recovers from a writer that was killed while it rewrote a
+ * slot: with the slot's sequence left odd in the file, a new writer's insert of the same
+ * puzzle must make the slot readable again, so that a lookup hits.
+ *
+ * usage: store_test work_directory
+ */
+
+const char puzzle[] = "300200000000107000706030500070009080900020004010800050009040301000702000000008006";
+const char solution[] = "351286497492157638786934512275469183938521764614873259829645371163792845547318926";
+
+SolutionStore::Entry make_entry()
+{
+    SolutionStore::Entry entry;
+    entry.status = SolveStatus::solved;
+    entry.guesses = 0;
+    entry.microseconds = 1;
+    memcpy(entry.board, solution, sizeof(entry.board));
+    return entry;
+}
+
+// Makes the sequence of every used slot odd, as a writer killed mid-write leaves it.
+int plant_odd_sequences(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDWR);
+    int planted = 0;
+    SolutionStore::Slot slot;
+    for (off_t offset = sizeof(SolutionStore::Header);
+         pread(fd, &slot, sizeof(slot), offset) == sizeof(slot); offset += sizeof(slot))
+    {
+        if (slot.last_used != 0)
+        {
+            slot.sequence |= 1;
+            pwrite(fd, &slot.sequence, sizeof(slot.sequence), offset);
+            planted++;
+        }
+    }
+    close(fd);
+    return planted;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: store_test work_directory" << std::endl;
+        return 2;
+    }
+    std::string path = std::string(argv[1]) + "/store_test.store";
+    std::remove(path.c_str());
+
+    // each store takes the writer lock when it is first used, and releases it when destroyed.
+    auto store = std::make_unique<SolutionStore>();
+    store->configure(path, 1);
+    store->insert(puzzle, make_entry());
+    store.reset();
+
+    if (plant_odd_sequences(path) != 1)
+    {
+        std::cout << "Expected the puzzle in exactly one slot" << std::endl;
+        return 1;
+    }
+
+    store = std::make_unique<SolutionStore>();
+    store->configure(path, 1);
+    SolutionStore::Entry entry;
+    bool found_torn = store->lookup(puzzle, entry);
+    store->insert(puzzle, make_entry());
+    bool found = store->lookup(puzzle, entry);
+    store.reset();
+    std::remove(path.c_str());
+
+    std::cout << "lookup of the slot with an odd sequence: " << (found_torn ? "hit" : "miss")
+              << ", after inserting again: " << (found ? "hit" : "miss") << std::endl;
+    if (found_torn || !found || std::string(entry.board, sizeof(entry.board)) != solution)
+    {
+        return 1;
+    }
+    return 0;
+}